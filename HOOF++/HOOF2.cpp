@@ -1,27 +1,34 @@
 #include <string>
+#include <vector>
+#include <optional>
 #include <iostream>
-#include <fstream>
 #include <filesystem>
 #include <chrono>
-#include <stdexcept>
-#include <execinfo.h>
+#include <thread>
+#include <set>
+#include <map>
 #include <HoofTypes.h>
 #include <HoofAux.h>
 #include <HoofSettings.h>
-#include <HoofWorker.h>
-#include <HoofData.h>
-#include <HoofH5File.h>
-#include <HoofHomogenizer.h>
-#include <HoofDealiaser.h>
-#include <HoofSuperober.h>
+#include <HoofProcessor.h>
+#include <HoofScheduler.h>
+#include <HoofSupervisor.h>
+#include <HoofArchive.h>
+#include <HoofIOThread.h>
+#include <HoofCounters.h>
+#include <HoofMemory.h>
+#include <HoofTrace.h>
+#include <HoofMetrics.h>
+#include <HoofLog.h>
+#include <HoofShm.h>
+#include <HoofAssembler.h>
 
 using std::string;
+using std::vector;
+using std::optional;
 using std::cout;
 using std::endl;
 using std::filesystem::directory_iterator;
-using std::filesystem::file_size;
-using std::filesystem::remove;
-using std::ofstream;
 using std::chrono::duration_cast;
 using namespace hoof;
 
@@ -38,54 +45,187 @@ using namespace hoof;
    - HDF5 library 1.10.10
 
    \section comp Compiling:
-   h5c++ -o HOOF2 -I. Hoof*.cpp -lgsl HOOF2.cpp -O2
+   h5c++ -o HOOF2 -I. Hoof*.cpp -lgsl -lz HOOF2.cpp -O2
 
    \section run Running:
-   ./HOOF2 <namelistfile> <input folder> <output folder>
+   ./HOOF2 <namelistfile> <input folder> <output folder> [--max-memory <MB>] [--trace <file>] [--watch <s>]
+
+   \section archives Archives:
+   Input files can be stored in .tar archives or compressed into .gz files. They are read into memory and
+   opened as HDF5 file images without extracting them, [Decompression threads] of them are read ahead in
+   background threads. Output files of .gz files are named without .gz, those of tar members by the archive
+   and the member name, e.g. volumes_x.h5 for volumes.tar/x.h5, so members with the same name in different
+   archives get their own output. Output files can be packed into the tar archive [Output archive] in the
+   output folder.
+
+   \section plan Output mode:
+   With [Output mode] PLANNED, the homogenizer does not copy the datasets that dealiasing or superobing
+   replace and dealiased data is not written when superobing replaces it, so every dataset is written
+   exactly once and the output file has no unused space from deleted datasets. With SUPEROBS, no
+   full resolution dataset is written, the output holds the homogenized metadata and only the superobed
+   moments and quality, and data and quality groups that superobing does not write are left out.
+
+   \section core Output in memory:
+   With [Output in memory], each output file is built in memory with the HDF5 core driver and written to
+   disk in one sequential write when it is closed, which avoids the many small metadata writes that
+   are slow on parallel file systems.
+
+   \section io Write behind:
+   With [Write behind], the dealiased and superobed output is only recorded during processing and an
+   I/O thread writes and closes the output file while the next file is processed. All output is
+   written before HOOF finishes. Needs a thread-safe HDF5 library and is not used with worker processes.
+
+   \section atomic Atomic output:
+   With [Atomic output], each output file is written under a hidden temporary name in the output folder
+   and renamed to its name only after it is closed, so programs watching the output folder can read
+   every .h5 file they see at once. The output of a file that fails is removed. [Fsync output] flushes
+   the file and the folder to disk around the rename and [Done markers] adds an empty .done file.
+
+   \section shm Shared memory ring:
+   With [Shared memory ring], the superobs of each file are published to a POSIX shared memory ring as soon
+   as superobing is done, so a converter on the same node reads them in place without polling the output
+   folder. Consumers are woken with a futex and detect records they lost by falling behind by more than
+   [Shared memory ring size in MB]. hoofshm.cpp is a reference consumer and hoofshmbench.cpp measures the
+   latency; both are built with g++ -std=c++17 -O2 -I. HoofShm.cpp <file> -pthread -lrt
+
+   \section counters Hardware counters:
+   With [Hardware counters], cycles, instructions, cache misses, branch misses and page faults of every
+   stage are read with perf_event_open, printed next to the timings and written to [Counters CSV file]
+   in the output folder. Counters that are not available, e.g. in containers, are left out.
+
+   \section memory Memory profiling:
+   With [Memory profiling], allocations, allocated bytes and the peak resident memory of every stage
+   and file are printed. The summary at the end gives the highest peak memory of one file, which is
+   about what each worker process needs. Only C++ allocations are counted, not those of HDF5 and GSL.
+
+   \section hdf5 HDF5 accounting:
+   With [HDF5 accounting], group opens, link and attribute checks, attribute and dataset reads and writes
+   and the bytes they move are counted and timed per stage and printed for every file. Writes done by
+   the write behind I/O thread are not included.
+
+   \section trace Timeline trace:
+   With --trace <file>, stages, HDF5 dataset reads and writes and waits for queues and workers are
+   written to the file as a timeline in the Trace Event format, with process and thread ids and file
+   names. Open it in Perfetto or chrome://tracing to see where workers idle.
+
+   \section metrics Metrics:
+   With [Metrics file], processed and failed files, stage duration and arrival to output latency
+   histograms, bytes read and written, queue depth and worker utilization are written in the Prometheus
+   text format after every file and at the end of the batch, for the textfile collector of node_exporter.
+
+   \section workers Worker processes:
+   If [Number of worker processes] in the namelist is larger than 0, files are processed in a pool of
+   forked worker processes. A worker that crashes is restarted and its input file is written to the
+   quarantine list in the output folder, so the rest of the batch is still processed.
+   With [Maximum memory in MB] or --max-memory, the peak memory of each file is estimated from its
+   sweep dimensions when it is handed to a worker, for archived files from their uncompressed size, and
+   files are only started when they fit into the budget next to the files already being processed; a
+   file that does not fit waits and, if needed, is processed alone.
+
+   \section sched Scheduling:
+   [Scheduling policy] FILESYSTEM keeps the directory order, LARGEST processes the most expensive files
+   first and NEWEST processes the volumes with the newest nominal time first. The cost of a file is estimated from its size or, with [Cost estimate] METADATA, from the
+   number of sweeps, rays and bins. Files are distributed into per-worker queues and idle workers take
+   work from the most loaded queue. Volumes older than [Maximum volume age in minutes] are dropped or
+   deferred to the end of the batch, and the latency from file arrival to output is printed per file.
+
+   \section capi C and Fortran interface:
+   HoofCApi.h lets assimilation code process files in its own process and get the superobs directly:
+   hoof_open reads the namelist, hoof_process_file processes one file and writes its output as above,
+   hoof_get_superobs copies the DBZ or VRAD superobs and their coordinates into caller buffers and
+   hoof_free closes it. hoof_mod.F90 binds it for Fortran. Build it as a library with
+   h5c++ -shared -fPIC -o libhoof.so -I. Hoof*.cpp -lgsl -lz -O2
+
+   \section python Python module:
+   hoofpy.cpp builds the hoof Python module, a faster backend for HOOF.py workflows. hoof.process returns
+   the homogenized, dealiased and superobed volume as arrays that numpy.asarray() views without copying.
+   Build it with
+   h5c++ -shared -fPIC $(python3-config --includes) -o hoof$(python3-config --extension-suffix) -I. Hoof*.cpp hoofpy.cpp -lgsl -lz -O2
+
+   \section scans Volumes from SCAN files:
+   With [Scan assembly], input files whose /what/object is SCAN are not processed on their own but
+   grouped into volumes by site and nominal time. The sweep of each SCAN file is copied into its volume
+   in memory when the file is read, with its chunks still compressed, and the volume is processed when it
+   has all [Expected elevations] of its site or [Scan timeout in s] after its newest sweep arrived. A sweep
+   that arrives after its volume was processed is skipped. Volumes that are still waiting when the batch
+   ends are left for the next run.
+
+   \section watch Watching the input folder:
+   With --watch <s>, HOOF keeps checking the input folder after the batch and processes files as they
+   arrive, until no file arrived for <s> seconds and no volume waits for sweeps. Files whose name starts
+   with a dot are taken as still being written. Only used without worker processes.
+
+   \section swmr Files still being written:
+   With [SWMR input], an input file that another process is still writing in SWMR mode (the writer has
+   precreated its datasets and appends rays to them) is not skipped or read half-written. HOOF opens it
+   for SWMR reading once per second and copies each sweep into memory as soon as all its data have
+   /where/nrays rays, so the file is mostly read when its writer closes it. It is then processed from
+   memory without waiting for a fixed delay. A file that got no complete sweep for [Scan timeout in s] is
+   processed with the sweeps it has.
+
+   \section sample Wind models from a sample:
+   With [Fit sample size], the wind model of a height sector with more good points is fitted to that many
+   of them, taken at even steps through the points ordered by elevation, azimuth and range, so every
+   elevation and azimuth of the sector is represented. If the RMS residual of the fit is above
+   [Maximum fit residual in m/s], the sector is fitted again to all its good points. The number of sampled
+   sectors, their mean residual and the number refitted are printed. Every bin is still dealiased with the
+   model of its sector.
+
+   \section warm Warm start dealiasing:
+   With [Warm start dealiasing], the wind model (u, v) fitted in each height sector is kept per site for
+   the next volume of the site whose first VRAD sweep started at most [Warm start maximum age in minutes]
+   later or earlier. In that volume, a sector that had a model is fitted with it as a prior from at least
+   [Warm start minimum good points] good points instead of [Minimum good points in height sector], or from
+   a sample of [Warm start sample size] of them taken the same way, by solving the 2x2 normal equations directly. A sector
+   with fewer good points takes the previous model as its own, so its bins are dealiased instead of being
+   left without a model. Sectors without a previous model are fitted as before.
+
+   \section precision Precision:
+   With [Precision] FLOAT32, the dealiasing and superobing kernels work on float copies of the per bin
+   data: the torus mapping, wind models, Nyquist multiplier search and superob averages. Wind models are
+   still fitted in double and the results are kept in double, so the output and the superobs handed to
+   other programs keep their format. The hoofprecision tool processes the input files in both
+   precisions, times them and reports the largest difference of the written 8-bit values.
+
+   \section kernels Superob kernels:
+   The superobs are made by kernels compiled for the [Range bin factor] x [Ray angle factor] combinations
+   5x1, 3x3 and 10x1, which are chosen from a table when superobing starts. They add up the boxes with
+   loops of fixed length and walk along the rays, so the data are read and the superobs written in order.
+   Other combinations, and [Specialized superob kernels] FALSE, use the generic kernels. Both give the same
+   superobs. The hoofsuperobbench tool times both on a synthetic volume for each combination.
 
    \section other Other:
    Last five characters of the file name has to contain the radar site name as defined by OPERA
 */
 
 /**
-   @brief Prints the stack trace.
+   @brief Follows the input files that are still being written, adds the SCAN files among the input files
+      to their volumes, and adds the volumes and followed files that are finished to the input files.
+   @param assembler The assembler of volumes.
+   @param fileNames Names of the files in the input folder.
+   @return Names of the files and volumes to process.
 */
-void printStack()
-{
-   const int maxLines = 100;
-   void* addrlist[maxLines];
-   int addrlen = backtrace(addrlist, maxLines);
-   if (addrlen == 0) {
-      std::cerr << "  <empty stack>" << endl;
-      return;
-   }
-   char** symbollist = backtrace_symbols(addrlist, addrlen);
-   std::cerr << "Stack trace:" << endl;
-   for (int i = 0; i < addrlen; ++i) {
-      std::cerr << symbollist[i] << endl;
-   }
-   free(symbollist);
-}
-
-/**
-   @brief Helper function that handles errors. It writes error to output and closes all open files.
-   @param worker The worker object to handle. 
-   @param inFile The input file to close.
-   @param  outFile The output file to close.
-   @param logFile The log file to write output to and close.
-   @return True if errors occured, otherwise false.
- */
-bool handleErrors(HoofWorker& worker, HoofH5File& inFile, HoofH5File& outFile, ofstream& logFile)
+static vector<string> assemble(HoofAssembler& assembler, const vector<string>& fileNames)
 {
-   if(worker.errors.size() != 0)
+   vector<string> inputs;
+   for(const string& fileName : fileNames)
    {
-      worker.output(logFile);
-      outFile.close();
-      inFile.close();
-      logFile.close();
-      return true;
+      if(HoofSettings::swmrInput && assembler.follow(fileName))
+         continue;
+      try
+      {
+         if(HoofSettings::scanAssembly && assembler.add(fileName))
+            continue;
+      }
+      catch(...)
+      {
+         cout << "Could not check if " << fileName << " is a SCAN file" << endl;
+      }
+      inputs.push_back(fileName);
    }
-   return false;
+   vector<string> volumes = assembler.ready();
+   inputs.insert(inputs.end(), volumes.begin(), volumes.end());
+   return inputs;
 }
 
 // ---------------------------------------------------------------------------------
@@ -94,10 +234,10 @@ bool handleErrors(HoofWorker& worker, HoofH5File& inFile, HoofH5File& outFile, o
 int main(int argc, char* argv[])
 {
    // if HOOF is called wrongly, output instructions and exit
-   if(argc != 4)
+   if(argc < 4)
    {
       cout << "Wrong number of command line arguments, the syntax is:" << endl;
-      cout << "./HOOF2 <namelist file> <input folder> <output folder>" << endl;
+      cout << "./HOOF2 <namelist file> <input folder> <output folder> [--max-memory <MB>] [--trace <file>] [--watch <s>]" << endl;
       cout << "Last five characters of the file name has to contain the radar site name as defined by OPERA." << endl;
       return -1;   
    }
@@ -108,213 +248,223 @@ int main(int argc, char* argv[])
    string outFolder = argv[3];
    HoofSettings settings(namelist, inFolder, outFolder);
 
-   // get start time
-   Clock clock;
-   Time startTime = clock.now();
-
-   // get files in the input folder and loop on them
-   int allFiles = 0;
-   int goodFiles = 0;
-   for(auto& entry : directory_iterator(inFolder))
+   // optional command line arguments override the namelist
+   double watch = 0.0;
+   for(int i=4; i<argc; i++)
    {
-      // go only through files that have the correct extensions
-      bool extFound = false;
-      for(int i=0; i<HoofSettings::fileExtensions.size(); i++)
+      string option = argv[i];
+      if(option == "--max-memory" && i+1 < argc)
+         HoofSettings::maxMemory = HoofAux::to<double>(argv[++i]);
+      else if(option == "--trace" && i+1 < argc)
+         HoofTrace::start(argv[++i]);
+      else if(option == "--watch" && i+1 < argc)
+         watch = HoofAux::to<double>(argv[++i]);
+      else
       {
-         if(entry.path().extension() == HoofSettings::fileExtensions[i])
-         {
-            extFound = true;
-            break;
-         }
+         cout << "Unknown command line argument " << option << endl;
+         return -1;
       }
-      if(!extFound)
-         continue;
-      allFiles++;
-      
-      // --- determine file paths and open the log file
-      string stem = entry.path().stem().string();
-      string fileName = entry.path().filename().string();
-      string inFilePath = HoofSettings::inFolder + fileName;
-      string outFilePath = HoofSettings::outFolder + fileName;
-      string logFilePath = HoofSettings::outFolder + stem + ".log";
-      ofstream logFile(logFilePath);
-      cout << "--------------- processing file " << fileName << endl; 
-
-      // --- initialize timers and get beginning time
-      Time beginTime = clock.now();
-      Time timer[15];
-
-      // --- open the data object, determine the site name and open the input and output HDF5 files
-      timer[0] = clock.now();
-      cout << "Reading input file ..." << endl;
-      HoofData data;
-      data.site = stem.substr(stem.length()-5);
-      HoofH5File inFile(inFilePath.c_str(), "read");
-      HoofH5File outFile(outFilePath.c_str(), "write");
-      timer[1] = clock.now();  
+   }
 
-      try
+   // superob only output needs superobing, otherwise it would hold no data
+   if(HoofSettings::outputMode == "SUPEROBS" && !HoofSettings::superobing)
+   {
+      cout << "Superob only output needs superobing, writing planned output" << endl;
+      HoofSettings::outputMode = "PLANNED";
+   }
+
+   // watching the input folder processes arriving files in the main process
+   if(watch > 0.0 && HoofSettings::workers > 0)
+   {
+      cout << "Watching the input folder needs no worker processes, processing the files once" << endl;
+      watch = 0.0;
+   }
+
+   // write behind needs a thread-safe HDF5 library and a single processing process
+   if(HoofSettings::writeBehind && (HoofSettings::workers > 0 || !HoofIOThread::available()))
+   {
+      cout << "Write behind needs a thread-safe HDF5 library and no worker processes, writing output inline" << endl;
+      HoofSettings::writeBehind = false;
+   }
+
+   // check which hardware counters are available and start the CSV file
+   if(HoofSettings::hardwareCounters)
+   {
+      HoofCounters probe;
+      HoofCounters::Sample sample = probe.read();
+      string missing;
+      for(int i=0; i<HoofCounters::nCounters; i++)
       {
-      // --- homogenize data
-      cout << "Homogenizing data ..." << endl;
-      HoofHomogenizer homogenizer(inFile, outFile, data);
-      homogenizer.sort();
-      timer[2] = clock.now();
-  
-      // check that required attributes are present in homogenized data
-      cout << "Checking and writing homogenized data to file ..." << endl;
-      homogenizer.checkAndWrite();
-      if(handleErrors(homogenizer, inFile, outFile, logFile))
-         continue;
-      timer[3] = clock.now();
-  
-      // write the homogenized data needed by dealiasing and superobing to the data object
-      if(HoofSettings::dealiasing || HoofSettings::superobing)
+         if(sample[i] < 0)
+            missing += " " + HoofCounters::names[i];
+      }
+      if(!probe.available())
       {
-         cout << "Storing homogenized data for further use ..." << endl;
-         homogenizer.storeData();
-         if(handleErrors(homogenizer, inFile, outFile, logFile))
-            continue;
-         timer[4] = clock.now(); 
+         cout << "Hardware counters are not available (see perf_event_paranoid), printing timings only" << endl;
+         HoofSettings::hardwareCounters = false;
       }
- 
-      // write warnings from homogenization to log
-      cout << "Writing warnings to log ..." << endl;
-      homogenizer.output(logFile);
-
-      // dealiasing
-      if(HoofSettings::dealiasing)
+      else
       {
-         // check if VRAD data is ok for dealiasing
-         cout << "Checking VRAD data for dealiasing ..." << endl;
-         HoofDealiaser dealiaser(data, outFile);
-         dealiaser.checkData();
-         timer[5] = clock.now();
-
-         // calculate quantities used in the minimization to get the wind model
-         cout << "Calculating wind model quantities ..." << endl;
-         dealiaser.calculateWindModelQtys();
-         timer[6] = clock.now();
-
-         // determine height sectors
-         cout << "Determining height sectors ..." << endl;
-         dealiaser.determineHeightSectors();
-         timer[7] = clock.now();
-
-         // calculate wind models
-         cout << "Calculating wind models ..." << endl;
-         dealiaser.calculateWindModels();
-         timer[8] = clock.now();
-
-         // dealias
-         cout << "Dealiasing ..." << endl;
-         dealiaser.dealias();
-         timer[9] = clock.now();   
-         
-         // write dealiased data
-         cout << "Writing dealiased data to file ..." << endl;
-         dealiaser.write();
-         timer[10] = clock.now();
-
-         // write warnings from dealiasing to log
-         cout << "Writing warnings to log ..." << endl;
-         dealiaser.output(logFile);
+         if(!missing.empty())
+            cout << "Hardware counters not available:" << missing << endl;
+         HoofCounters::startCsv();
       }
+   }
+
+   // start counting allocations and the metrics of the batch
+   HoofMemory::start();
+   HoofMetrics::start();
+
+   // map the shared memory ring before worker processes are forked, they publish to it too
+   if(HoofSettings::sharedMemoryRing != "NONE" && HoofSettings::superobing)
+      HoofShm::start(HoofSettings::sharedMemoryRing, HoofSettings::sharedMemoryRingSize);
+
+   // get start time
+   Clock clock;
+   Time startTime = clock.now();
+
+   // get files in the input folder and in its archives that have the correct extensions
+   vector<string> fileNames;
+   for(auto& entry : directory_iterator(inFolder))
+   {
+      vector<string> inputs = HoofArchive::inputs(entry.path().filename().string());
+      fileNames.insert(fileNames.end(), inputs.begin(), inputs.end());
+   }
+   std::set<string> seen(fileNames.begin(), fileNames.end());
+
+   // assemble volumes from SCAN files, the finished volumes are processed like files
+   HoofAssembler assembler;
+   if(HoofSettings::scanAssembly || HoofSettings::swmrInput)
+      fileNames = assemble(assembler, fileNames);
+   int allFiles = fileNames.size();
+   int goodFiles = 0;
+
+   // order the files and distribute them into one queue per worker
+   HoofScheduler scheduler(fileNames, HoofSettings::workers > 0 ? HoofSettings::workers : 1);
 
-      // superobing
-      if(HoofSettings::superobing)
+   // process the files either in the main process or in a pool of worker processes
+   HoofProcessor processor;
+
+   // with write behind a file is only finished when the I/O thread has written its output, until then
+   // its job and metrics record wait here, so the latency is measured to the written output and files
+   // whose output fails are neither counted as processed nor packed
+   std::map<string, std::pair<HoofJob, string>> writing;
+   auto complete = [&](const vector<string>& written)
+   {
+      for(const string& fileName : written)
       {
-         // check if data is ok for superobing
-         cout << "Checking data for superobing ..." << endl;
-         HoofSuperober superober(data, outFile);
-         superober.checkData();
-         timer[11] = clock.now();
-
-         // prepare superobed metadata
-         cout << "Preparing superobed metadata ..." << endl;
-         superober.prepareMetadata();
-         timer[12] = clock.now();
-
-         // superob
-         cout << "Superobing ..." << endl;
-         superober.superob();
-         timer[13] = clock.now();         
-
-         // write superobed data
-         cout << "Writing superobed data ..." << endl;
-         superober.write();
-         timer[14] = clock.now();  
-      }
+         auto it = writing.find(fileName);
+         if(it == writing.end())
+            continue;
+         goodFiles++;
+         HoofMetrics::add(it->second.second);
+         scheduler.finish(it->second.first);
+         writing.erase(it);
       }
-      catch(const std::exception& e)
+   };
+   auto succeeded = [&](const HoofJob& job)
+   {
+      writing[job.fileName] = {job, HoofMetrics::take()};
+      complete(HoofSettings::writeBehind ? processor.written() : vector<string>{job.fileName});
+   };
+   auto flush = [&]()
+   {
+      for(const string& fileName : processor.flush())
       {
-         cout << "Unknown error: " << e.what() << endl;
-         printStack();
-         continue;
+         writing.erase(fileName);
+         HoofMetrics::failed();
       }
-      catch(...)
+      complete(processor.written());
+   };
+   if(HoofSettings::workers > 0)
+   {
+      HoofSupervisor supervisor(processor, HoofSettings::workers);
+      goodFiles = supervisor.run(scheduler);
+      if(supervisor.quarantined.size() > 0)
+         cout << "HOOF put " << supervisor.quarantined.size() << " files into quarantine, see " <<
+            HoofSettings::outFolder + HoofSettings::quarantineList << endl;
+      if(scheduler.stolen > 0)
+         cout << "Idle workers took " << scheduler.stolen << " files from other workers' queues" << endl;
+   }
+   else
+   {
+      for(optional<HoofJob> job = scheduler.next(0); job; job = scheduler.next(0))
       {
-         cout << "Unknown error " << endl;
-         printStack();
-         continue;
+         // read the next archived files in the background while this one is processed
+         vector<string> ahead = scheduler.peek(0, HoofSettings::decompressionThreads);
+         for(int i=0; i<ahead.size(); i++)
+            processor.prefetch(ahead[i]);
+         if(processor.process(job.value().fileName))
+            succeeded(job.value());
+         else
+            HoofMetrics::failed();
+         HoofArchive::removeAssembled(job.value().fileName);
       }
 
-      // print timings
-      Time finishTime = clock.now();
-      if(HoofSettings::printConsoleTiming)
+      // wait until the I/O thread has written all output files
+      flush();
+   }
+
+   // process files as they arrive until none arrived for the watch time and no volume waits for sweeps,
+   // files that are still being written are waited for also without watching
+   if(watch > 0.0 || assembler.growing() > 0)
+   {
+      if(watch > 0.0)
+         cout << "Watching " << inFolder << " for new files" << endl;
+      Time idleSince = clock.now();
+      while(assembler.growing() > 0 || (watch > 0.0 && (assembler.pending() > 0 ||
+         std::chrono::duration<double>(clock.now() - idleSince).count() < watch)))
       {
-         cout << "Timings:" << endl;
-         cout << "   Input file reading:             " <<
-            duration_cast<Ms>(timer[1]-timer[0]).count() << " ms" << endl;
-         cout << "   Homogenization:                 " <<
-            duration_cast<Ms>(timer[2]-timer[1]).count() << " ms" << endl;
-         cout << "   Homogenization check/write:     " <<
-            duration_cast<Ms>(timer[3]-timer[2]).count() << " ms" << endl;
-         if(HoofSettings::dealiasing || HoofSettings::superobing)
-            cout << "   Storing homogenized data:       " <<
-               duration_cast<Ms>(timer[4]-timer[3]).count() << " ms" << endl;
-         if(HoofSettings::dealiasing)
-         {            
-            cout << "   Checking dealiasing data:       " <<
-               duration_cast<Ms>(timer[5]-timer[4]).count() << " ms" << endl;
-            cout << "   Calculating wind model theory:  " <<
-               duration_cast<Ms>(timer[6]-timer[5]).count() << " ms" << endl;  
-            cout << "   Determining height sectors:     " <<
-               duration_cast<Ms>(timer[7]-timer[6]).count() << " ms" << endl;
-            cout << "   Calculating wind models:        " <<
-               duration_cast<Ms>(timer[8]-timer[7]).count() << " ms" << endl;                             
-            cout << "   Dealiasing:                     " <<
-               duration_cast<Ms>(timer[9]-timer[8]).count() << " ms" << endl;   
-            cout << "   Writing dealiased data:         " <<
-               duration_cast<Ms>(timer[10]-timer[9]).count() << " ms" << endl;
+         std::this_thread::sleep_for(std::chrono::seconds(1));
+         vector<string> arrived;
+         if(watch > 0.0)
+         {
+            for(auto& entry : directory_iterator(inFolder))
+            {
+               string name = entry.path().filename().string();
+               if(name[0] == '.')
+                  continue;
+               for(const string& input : HoofArchive::inputs(name))
+               {
+                  if(seen.insert(input).second)
+                     arrived.push_back(input);
+               }
+            }
          }
-         if(HoofSettings::superobing)
+         if(!arrived.empty())
+            idleSince = clock.now();
+         if(HoofSettings::scanAssembly || HoofSettings::swmrInput)
+            arrived = assemble(assembler, arrived);
+         for(const string& fileName : arrived)
          {
-            if(HoofSettings::dealiasing)
-               cout << "   Checking superobing data:       " <<
-                  duration_cast<Ms>(timer[11]-timer[10]).count() << " ms" << endl;
+            allFiles++;
+            if(processor.process(fileName))
+            {
+               // recording the latency also writes the metrics file, so it is updated with every file
+               HoofJob job;
+               job.fileName = fileName;
+               job.arrival = HoofScheduler::arrival(fileName);
+               succeeded(job);
+            }
             else
-               cout << "   Checking superobing data:       " <<
-                  duration_cast<Ms>(timer[11]-timer[4]).count() << " ms" << endl;
-            cout << "   Preparing superobed metadata:   " <<
-               duration_cast<Ms>(timer[12]-timer[11]).count() << " ms" << endl;  
-            cout << "   Superobing:                     " <<
-               duration_cast<Ms>(timer[13]-timer[12]).count() << " ms" << endl;
-            cout << "   Writing superobed data:         " <<
-               duration_cast<Ms>(timer[14]-timer[13]).count() << " ms" << endl;                                  
+               HoofMetrics::failed();
+            HoofArchive::removeAssembled(fileName);
          }
+         complete(processor.written());
       }
-
-      // close the files and remove the log file if empty
-      goodFiles++;
-      logFile.close();
-      inFile.close();
-      outFile.close();
-      if(file_size(logFilePath) == 0)
-         remove(logFilePath);
-      Time endTime = clock.now();
-      cout << "Analysis time:   " << duration_cast<Ms>(endTime - beginTime).count() << " ms" << endl;
+      flush();
    }
+   if(assembler.pending() > 0)
+      cout << assembler.pending() << " volumes wait for more sweeps and are left for the next run" << endl;
+   if(scheduler.dropped > 0)
+      cout << "HOOF skipped " << scheduler.dropped << " stale volumes" << endl;
+   scheduler.printLatency();
+   HoofMemory::printSummary();
+   HoofTrace::flush();
+   HoofMetrics::write();
+   HoofLog::stop();
+   if(HoofSettings::outputArchive != "NONE")
+      HoofArchive::pack(scheduler.finished);
 
    Time endTime = clock.now();
    cout << "HOOF succesfully analysed " << goodFiles << " out of " << allFiles << " files in " << 
@@ -0,0 +1,482 @@
+/**
+   @file HoofArchive.cpp
+   @author Peter Smerkol
+   @brief Contains the HoofArchive class implementation.
+*/
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <zlib.h>
+#include <HoofSettings.h>
+#include <HoofH5File.h>
+#include <HoofArchive.h>
+
+using std::string;
+using std::vector;
+using std::map;
+using std::ifstream;
+using std::fstream;
+using std::ios;
+using std::cout;
+using std::endl;
+using std::filesystem::path;
+using std::filesystem::exists;
+using std::filesystem::file_size;
+using std::filesystem::remove;
+
+// size of a tar block, headers and data are padded to it
+static const std::uint64_t tarBlock = 512;
+
+/**
+   @brief Reads a numeric tar header field, stored either as octal text or as a base-256 number.
+   @param field The header field.
+   @param len Length of the field.
+   @return The number.
+*/
+static std::uint64_t tarNumber(const char* field, int len)
+{
+   std::uint64_t value = 0;
+   if((unsigned char)field[0] & 0x80)
+   {
+      for(int i=1; i<len; i++)
+         value = (value << 8) | (unsigned char)field[i];
+      return value;
+   }
+   for(int i=0; i<len && field[i] != '\0'; i++)
+   {
+      if(field[i] >= '0' && field[i] <= '7')
+         value = (value << 3) | (std::uint64_t)(field[i] - '0');
+   }
+   return value;
+}
+
+/**
+   @brief Reads a zero terminated tar header field.
+   @param field The header field.
+   @param len Length of the field.
+   @return The field as a string.
+*/
+static string tarString(const char* field, int len)
+{
+   return string(field, strnlen(field, len));
+}
+
+/**
+   @brief Writes a tar header for a regular file, preceded by a GNU long name entry if the name
+      does not fit into the header.
+   @param tar The archive to write to.
+   @param name Path of the member inside the archive.
+   @param size Size of the member data.
+   @param type Type of the entry ('0' for a regular file, 'L' for a long name).
+*/
+static void writeTarHeader(fstream& tar, const string& name, std::uint64_t size, char type = '0')
+{
+   if(name.size() >= 100)
+   {
+      writeTarHeader(tar, "././@LongLink", name.size()+1, 'L');
+      vector<char> longName((name.size() + tarBlock) / tarBlock * tarBlock, '\0');
+      memcpy(longName.data(), name.c_str(), name.size());
+      tar.write(longName.data(), longName.size());
+   }
+
+   char header[tarBlock] = {};
+   memcpy(header, name.c_str(), std::min<size_t>(name.size(), 99));
+   snprintf(header+100, 8, "%07o", 0644);
+   snprintf(header+108, 8, "%07o", 0);
+   snprintf(header+116, 8, "%07o", 0);
+   snprintf(header+124, 12, "%011llo", (unsigned long long)size);
+   snprintf(header+136, 12, "%011llo", (unsigned long long)std::time(nullptr));
+   header[156] = type;
+   memcpy(header+257, "ustar", 6);
+   memcpy(header+263, "00", 2);
+
+   // the checksum is computed with the checksum field filled with spaces
+   memset(header+148, ' ', 8);
+   unsigned int checksum = 0;
+   for(int i=0; i<tarBlock; i++)
+      checksum += (unsigned char)header[i];
+   snprintf(header+148, 8, "%06o", checksum);
+   header[155] = ' ';
+   tar.write(header, tarBlock);
+}
+
+/**
+   @brief Reads the headers of a tar archive and lists its regular files. GNU long names and pax
+      path records are supported.
+   @param tarPath Path of the archive.
+   @return The regular files in the archive.
+*/
+vector<HoofArchive::Member> HoofArchive::_readIndex(const string& tarPath)
+{
+   {
+      std::lock_guard<std::mutex> lock(_indexMutex);
+      if(_indexes.count(tarPath))
+         return _indexes[tarPath];
+   }
+
+   ifstream tar(tarPath, ios::binary);
+   if(!tar)
+      throw std::runtime_error("cannot open archive " + tarPath);
+
+   vector<Member> members;
+   char header[tarBlock];
+   std::uint64_t pos = 0;
+   string longName;
+   while(tar.read(header, tarBlock))
+   {
+      // two zero blocks end the archive
+      if(header[0] == '\0')
+         break;
+      std::uint64_t size = tarNumber(header+124, 12);
+      char type = header[156];
+      pos += tarBlock;
+
+      // the long name of the next entry is stored in the data of a GNU 'L' or a pax 'x' entry
+      if(type == 'L' || type == 'x')
+      {
+         vector<char> data(size);
+         tar.read(data.data(), size);
+         if(type == 'L')
+            longName = tarString(data.data(), size);
+         else
+         {
+            // pax records are "<length> <key>=<value>\n"
+            std::uint64_t r = 0;
+            while(r < size)
+            {
+               std::uint64_t len = std::strtoull(data.data() + r, nullptr, 10);
+               if(len == 0 || r + len > size)
+                  break;
+               string record(data.data() + r, len);
+               std::size_t key = record.find(' ');
+               if(key != string::npos && record.compare(key+1, 5, "path=") == 0)
+                  longName = record.substr(key+6, record.size() - key - 7);
+               r += len;
+            }
+         }
+      }
+      else
+      {
+         if(type == '0' || type == '\0')
+         {
+            string name = tarString(header, 100);
+            string prefix = tarString(header+345, 155);
+            if(!longName.empty())
+               name = longName;
+            else if(!prefix.empty() && memcmp(header+257, "ustar", 5) == 0)
+               name = prefix + "/" + name;
+            members.push_back({name, pos, size});
+         }
+         longName = "";
+      }
+
+      pos += (size + tarBlock - 1) / tarBlock * tarBlock;
+      tar.seekg(pos);
+   }
+
+   std::lock_guard<std::mutex> lock(_indexMutex);
+   _indexes[tarPath] = members;
+   return members;
+}
+
+/**
+   @brief Finds a member of a tar archive in the input folder.
+   @param fileName Name of the member, "<archive>.tar/<member path>".
+   @return The member.
+*/
+HoofArchive::Member HoofArchive::_findMember(const string& fileName)
+{
+   std::size_t split = fileName.find(".tar/") + 4;
+   string memberPath = fileName.substr(split + 1);
+   vector<Member> members = _readIndex(diskPath(fileName));
+   for(int i=0; i<members.size(); i++)
+   {
+      if(members[i].name == memberPath)
+         return members[i];
+   }
+   throw std::runtime_error("cannot find " + memberPath + " in archive " + diskPath(fileName));
+}
+
+/**
+   @brief Checks if a file name has one of the file extensions from the namelist.
+   @param fileName The file name.
+   @return True if the extension is listed in the namelist, false otherwise.
+*/
+bool HoofArchive::_hasExtension(const string& fileName)
+{
+   string extension = path(fileName).extension().string();
+   for(int i=0; i<HoofSettings::fileExtensions.size(); i++)
+   {
+      if(extension == HoofSettings::fileExtensions[i])
+         return true;
+   }
+   return false;
+}
+
+/**
+   @brief Gets the names of the files to process that are stored in a file of the input folder. A tar
+      archive gives its members with a namelist extension, a gzip file gives itself if its name without
+      .gz has a namelist extension and any other file gives itself if it has a namelist extension.
+   @param fileName Name of the file in the input folder.
+   @return Names of the files to process.
+*/
+vector<string> HoofArchive::inputs(const string& fileName)
+{
+   vector<string> names;
+   string extension = path(fileName).extension().string();
+   if(extension == ".tar")
+   {
+      vector<Member> members = _readIndex(HoofSettings::inFolder + fileName);
+      for(int i=0; i<members.size(); i++)
+      {
+         if(_hasExtension(members[i].name))
+            names.push_back(fileName + "/" + members[i].name);
+      }
+   }
+   else if(extension == ".gz")
+   {
+      if(_hasExtension(path(fileName).stem().string()))
+         names.push_back(fileName);
+   }
+   else if(_hasExtension(fileName))
+      names.push_back(fileName);
+   return names;
+}
+
+/**
+   @brief Checks if a file is stored in a tar archive or compressed with gzip.
+   @param fileName Name of the file.
+   @return True if the file has to be read into memory, false if it can be opened directly.
+*/
+bool HoofArchive::isArchived(const string& fileName)
+{
+   if(fileName.find(".tar/") != string::npos || path(fileName).extension() == ".gz")
+      return true;
+   std::lock_guard<std::mutex> lock(_assembledMutex);
+   return _assembled.count(fileName) > 0;
+}
+
+/**
+   @brief Gets the name of a file without its archive or .gz extension, which is the name used
+      for output files.
+   @param fileName Name of the file.
+   @return The plain file name.
+*/
+string HoofArchive::memberName(const string& fileName)
+{
+   if(fileName.find(".tar/") != string::npos)
+      return path(fileName.substr(fileName.find(".tar/") + 5)).filename().string();
+   if(path(fileName).extension() == ".gz")
+      return path(fileName).stem().string();
+   return fileName;
+}
+
+/**
+   @brief Gets the name of the output and log files of a file. A tar member is named by the archive and
+      its own name, e.g. "volumes_x.h5" for "volumes.tar/dir/x.h5", so members with the same name in
+      different archives do not overwrite each other's output.
+   @param fileName Name of the file.
+   @return The output file name.
+*/
+string HoofArchive::outputName(const string& fileName)
+{
+   if(fileName.find(".tar/") != string::npos)
+      return path(fileName.substr(0, fileName.find(".tar/"))).filename().string() + "_" + memberName(fileName);
+   return memberName(fileName);
+}
+
+/**
+   @brief Gets the path on disk of a file or of the archive that contains it.
+   @param fileName Name of the file.
+   @return Path in the input folder.
+*/
+string HoofArchive::diskPath(const string& fileName)
+{
+   if(fileName.find(".tar/") != string::npos)
+      return HoofSettings::inFolder + fileName.substr(0, fileName.find(".tar/") + 4);
+   return HoofSettings::inFolder + fileName;
+}
+
+/**
+   @brief Gets the uncompressed size of a file. For gzip files the size is read from the gzip
+      trailer, which holds it modulo 4 GB.
+   @param fileName Name of the file.
+   @return Size in bytes.
+*/
+double HoofArchive::size(const string& fileName)
+{
+   if(fileName.find(".tar/") != string::npos)
+      return (double)_findMember(fileName).size;
+   {
+      std::lock_guard<std::mutex> lock(_assembledMutex);
+      auto it = _assembled.find(fileName);
+      if(it != _assembled.end())
+         return (double)it->second.size();
+   }
+   if(path(fileName).extension() == ".gz")
+   {
+      ifstream gz(diskPath(fileName), ios::binary);
+      unsigned char trailer[4] = {};
+      gz.seekg(-4, ios::end);
+      gz.read((char*)trailer, 4);
+      return (double)(trailer[0] | trailer[1] << 8 | trailer[2] << 16 | (std::uint32_t)trailer[3] << 24);
+   }
+   return (double)file_size(diskPath(fileName));
+}
+
+/**
+   @brief Reads a tar archive member or decompresses a gzip file into memory, or copies the image of
+      an assembled volume.
+   @param fileName Name of the file.
+   @return The file contents.
+*/
+vector<char> HoofArchive::read(const string& fileName)
+{
+   {
+      std::lock_guard<std::mutex> lock(_assembledMutex);
+      auto it = _assembled.find(fileName);
+      if(it != _assembled.end())
+         return it->second;
+   }
+   vector<char> image;
+   if(fileName.find(".tar/") != string::npos)
+   {
+      Member member = _findMember(fileName);
+      ifstream tar(diskPath(fileName), ios::binary);
+      image.resize(member.size);
+      tar.seekg(member.offset);
+      if(!tar.read(image.data(), member.size))
+         throw std::runtime_error("cannot read " + fileName);
+      return image;
+   }
+
+   gzFile gz = gzopen(diskPath(fileName).c_str(), "rb");
+   if(gz == nullptr)
+      throw std::runtime_error("cannot open " + fileName);
+   gzbuffer(gz, 1 << 18);
+   image.reserve((std::size_t)size(fileName));
+   const int chunk = 1 << 20;
+   while(true)
+   {
+      std::size_t pos = image.size();
+      image.resize(pos + chunk);
+      int n = gzread(gz, image.data() + pos, chunk);
+      if(n < 0)
+      {
+         gzclose(gz);
+         throw std::runtime_error("cannot decompress " + fileName);
+      }
+      image.resize(pos + n);
+      if(n < chunk)
+         break;
+   }
+   gzclose(gz);
+   return image;
+}
+
+/**
+   @brief Opens a file from the input folder for reading, from memory if it is archived.
+   @param fileName Name of the file.
+   @return The opened file.
+*/
+HoofH5File HoofArchive::open(const string& fileName)
+{
+   if(!isArchived(fileName))
+      return HoofH5File(diskPath(fileName), "read");
+   return HoofH5File(read(fileName), memberName(fileName));
+}
+
+/**
+   @brief Adds the image of a volume assembled from SCAN files, which is then read like an archived file.
+   @param fileName Name of the volume.
+   @param image The HDF5 file image.
+*/
+void HoofArchive::addAssembled(const string& fileName, vector<char>&& image)
+{
+   std::lock_guard<std::mutex> lock(_assembledMutex);
+   _assembled[fileName] = std::move(image);
+}
+
+/**
+   @brief Frees the image of an assembled volume after it was processed.
+   @param fileName Name of the volume.
+*/
+void HoofArchive::removeAssembled(const string& fileName)
+{
+   std::lock_guard<std::mutex> lock(_assembledMutex);
+   _assembled.erase(fileName);
+}
+
+/**
+   @brief Appends the output files of processed files to the output archive in the output folder and
+      removes them and their .done markers from the output folder. An existing archive is extended.
+   @param fileNames Names of the processed input files.
+*/
+void HoofArchive::pack(const vector<string>& fileNames)
+{
+   string tarPath = HoofSettings::outFolder + HoofSettings::outputArchive;
+
+   // find the end of the last entry in an existing archive, where the end of archive blocks begin
+   std::uint64_t end = 0;
+   if(exists(tarPath))
+   {
+      ifstream old(tarPath, ios::binary);
+      char header[tarBlock];
+      while(old.read(header, tarBlock) && header[0] != '\0')
+      {
+         end += tarBlock + (tarNumber(header+124, 12) + tarBlock - 1) / tarBlock * tarBlock;
+         old.seekg(end);
+      }
+   }
+   fstream tar(tarPath, ios::in | ios::out | ios::binary);
+   if(!tar.is_open())
+      tar.open(tarPath, ios::out | ios::binary);
+   if(!tar.is_open())
+      throw std::runtime_error("cannot open output archive " + tarPath);
+   tar.seekp(end);
+
+   vector<string> packed;
+   for(int i=0; i<fileNames.size(); i++)
+   {
+      string outPath = HoofSettings::outFolder + outputName(fileNames[i]);
+      if(!exists(outPath))
+         continue;
+      ifstream out(outPath, ios::binary);
+      vector<char> data(file_size(outPath));
+      out.read(data.data(), data.size());
+      writeTarHeader(tar, outputName(fileNames[i]), data.size());
+      tar.write(data.data(), data.size());
+      vector<char> padding((tarBlock - data.size() % tarBlock) % tarBlock, '\0');
+      tar.write(padding.data(), padding.size());
+      packed.push_back(outPath);
+   }
+   vector<char> endBlocks(2*tarBlock, '\0');
+   tar.write(endBlocks.data(), endBlocks.size());
+   tar.close();
+   if(!tar)
+      throw std::runtime_error("cannot write output archive " + tarPath);
+
+   // the .done markers of [Done markers] go with their files, pollers must not see markers of missing files
+   std::error_code ignored;
+   for(int i=0; i<packed.size(); i++)
+   {
+      remove(packed[i]);
+      remove(packed[i] + ".done", ignored);
+   }
+   cout << "Packed " << packed.size() << " output files into " << tarPath << endl;
+}
+
+// --- initialize static members
+map<string, vector<HoofArchive::Member>> HoofArchive::_indexes;
+std::mutex HoofArchive::_indexMutex;
+map<string, vector<char>> HoofArchive::_assembled;
+std::mutex HoofArchive::_assembledMutex;
@@ -0,0 +1,79 @@
+/**
+   @file HoofArchive.h
+   @author Peter Smerkol
+   @brief Contains definition of HoofArchive class.
+*/
+
+#ifndef HOOFARCHIVE_GUARD
+#define HOOFARCHIVE_GUARD
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstdint>
+#include <HoofH5File.h>
+
+/**
+   @class HoofArchive
+   @brief Static class that reads input files from tar archives and gzip files and packs output files
+      into a tar archive.
+
+   A file inside an archive is named by the archive and the member path, e.g. "volumes.tar/x.h5", and
+   a gzip file by its own name, e.g. "x.h5.gz". Such files are read into memory and opened as HDF5
+   file images, so they never have to be extracted to disk. Volumes assembled from SCAN files (see
+   HoofAssembler) are kept as file images under their volume name and read the same way.
+*/
+class HoofArchive
+{
+   private:
+      /**
+         @struct Member
+         @brief Holds the position of one regular file inside a tar archive.
+      */
+      struct Member
+      {
+         std::string name;     ///< Path of the member inside the archive.
+         std::uint64_t offset; ///< Offset of the member data from the start of the archive.
+         std::uint64_t size;   ///< Size of the member data in bytes.
+      };
+
+      // members
+      static std::map<std::string, std::vector<Member>> _indexes;  ///< Tar archive indexes already read.
+      static std::mutex _indexMutex;                               ///< Guards the indexes against prefetching threads.
+      static std::map<std::string, std::vector<char>> _assembled;  ///< Images of assembled volumes, by name.
+      static std::mutex _assembledMutex;                           ///< Guards the assembled volumes.
+
+      // reads the headers of a tar archive
+      static std::vector<Member> _readIndex(const std::string& tarPath);
+      // finds a member of a tar archive
+      static Member _findMember(const std::string& fileName);
+      // checks if a file name has one of the namelist file extensions
+      static bool _hasExtension(const std::string& fileName);
+
+   public:
+      // gets the names of the files to process that are stored in a file of the input folder
+      static std::vector<std::string> inputs(const std::string& fileName);
+      // checks if a file is stored in an archive or compressed
+      static bool isArchived(const std::string& fileName);
+      // gets the name of the file without the archive
+      static std::string memberName(const std::string& fileName);
+      // gets the name of the output file, qualified with the archive name for tar members
+      static std::string outputName(const std::string& fileName);
+      // gets the path of the file or its archive on disk
+      static std::string diskPath(const std::string& fileName);
+      // gets the uncompressed size of a file
+      static double size(const std::string& fileName);
+      // reads an archived file into memory
+      static std::vector<char> read(const std::string& fileName);
+      // opens a file from the input folder for reading
+      static HoofH5File open(const std::string& fileName);
+      // adds the image of an assembled volume
+      static void addAssembled(const std::string& fileName, std::vector<char>&& image);
+      // frees the image of an assembled volume after it was processed
+      static void removeAssembled(const std::string& fileName);
+      // appends output files to the output archive and removes them from the output folder
+      static void pack(const std::vector<std::string>& fileNames);
+};
+
+#endif // HOOFARCHIVE_GUARD
@@ -0,0 +1,296 @@
+/**
+   @file HoofAssembler.cpp
+   @author Peter Smerkol
+   @brief Contains the HoofAssembler class implementation.
+*/
+
+#include <string>
+#include <vector>
+#include <map>
+#include <optional>
+#include <numeric>
+#include <algorithm>
+#include <utility>
+#include <iostream>
+#include <filesystem>
+#include <cmath>
+#include <cctype>
+#include <ctime>
+#include <sys/stat.h>
+#include <HoofSettings.h>
+#include <HoofH5File.h>
+#include <HoofArchive.h>
+#include <HoofTrace.h>
+#include <HoofAssembler.h>
+
+using std::string;
+using std::vector;
+using std::optional;
+using std::cout;
+using std::endl;
+using std::filesystem::path;
+
+/**
+   @brief Adds a file to its volume if it is a SCAN file, copying its sweep into the volume at once.
+      A file that is not a SCAN file, or lacks the nominal time or elevation angle, is left alone.
+   @param fileName Name of the file in the input folder.
+   @return True if the file was taken as a sweep, false if it has to be processed on its own.
+*/
+bool HoofAssembler::add(const string& fileName)
+{
+   HoofTrace::Scope scope("Add sweep", "stage");
+   HoofH5File scan = HoofArchive::open(fileName);
+   optional<string> object = scan.getAtt<string>("/what", "object");
+   if(!object || object.value() != "SCAN")
+   {
+      scan.close();
+      return false;
+   }
+   optional<string> date = scan.getAtt<string>("/what", "date");
+   optional<string> time = scan.getAtt<string>("/what", "time");
+   optional<double> elangle = scan.getAtt<double>("/dataset1/where", "elangle");
+   string started = scan.getAtt<string>("/dataset1/what", "startdate").value_or("") +
+      scan.getAtt<string>("/dataset1/what", "starttime").value_or("");
+   if(!date || !time || !elangle)
+   {
+      cout << "SCAN file " << fileName << " has no nominal time or elevation angle, processing it alone" << endl;
+      scan.close();
+      return false;
+   }
+
+   // the volume is named like the SCAN file, with the nominal time in place of its first date
+   string member = HoofArchive::memberName(fileName);
+   string stem = path(member).stem().string();
+   string site = stem.substr(stem.length()-5);
+   string prefix = "";
+   size_t start = 0;
+   for(size_t i=0; i<member.size(); i++)
+   {
+      if(!std::isdigit((unsigned char)member[i]))
+         start = i + 1;
+      else if(i + 1 - start >= 12)
+      {
+         prefix = member.substr(0, start);
+         break;
+      }
+   }
+   string name = prefix + date.value() + time.value() + "_" + site + path(member).extension().string();
+   if(_finished.count(name))
+   {
+      cout << "Sweep " << elangle.value() << " of " << name << " arrived after the volume was finished, skipping " <<
+         fileName << endl;
+      scan.close();
+      return true;
+   }
+
+   // start a new volume with the top level groups of its first sweep
+   auto it = _volumes.find(name);
+   if(it == _volumes.end())
+   {
+      Volume volume;
+      volume.site = site;
+      volume.file = HoofH5File(name, "image");
+      scan.copyAttributes(volume.file, "/");
+      for(const string group : {"what", "where", "how"})
+      {
+         if(scan.hasDataset("/", group))
+            scan.copyDataset(volume.file, "/" + group, "/" + group);
+      }
+      volume.file.writeAtt<string>("/what", "object", "PVOL");
+      it = _volumes.emplace(name, volume).first;
+   }
+   Volume& volume = it->second;
+
+   // a sweep can be delivered twice, sweeps at the same elevation with other start times are kept
+   for(int i=0; i<volume.elangles.size(); i++)
+   {
+      if(std::abs(volume.elangles[i] - elangle.value()) < 1e-3 && volume.starts[i] == started)
+      {
+         cout << "Sweep " << elangle.value() << " of " << name << " was already received, skipping " << fileName << endl;
+         scan.close();
+         return true;
+      }
+   }
+   scan.copyDataset(volume.file, "/dataset1", "/sweep" + std::to_string(volume.elangles.size() + 1));
+   scan.close();
+   volume.elangles.push_back(elangle.value());
+   volume.starts.push_back(started);
+   struct stat st;
+   std::time_t arrival = stat(HoofArchive::diskPath(fileName).c_str(), &st) == 0 ? st.st_mtime : std::time(nullptr);
+   volume.newest = volume.elangles.size() == 1 ? arrival : std::max(volume.newest, arrival);
+   cout << "Added sweep " << elangle.value() << " to " << name << " (" << volume.elangles.size() << " sweeps)" << endl;
+   return true;
+}
+
+/**
+   @brief Follows a file that another process is still writing in SWMR mode and copies the sweeps that
+      are already complete.
+   @param fileName Name of the file in the input folder.
+   @return True if the file is being written and is followed, false if it can be processed now.
+*/
+bool HoofAssembler::follow(const string& fileName)
+{
+   if(_growing.count(fileName))
+      return true;
+   if(HoofArchive::isArchived(fileName) || !HoofH5File::writing(HoofArchive::diskPath(fileName)))
+      return false;
+   cout << fileName << " is still being written, reading its complete sweeps while it grows" << endl;
+   Volume& volume = _growing[fileName];
+   volume.file = HoofH5File(fileName, "image");
+   volume.newest = std::time(nullptr);
+   _grow(fileName, volume, false);
+   return true;
+}
+
+/**
+   @brief Copies the sweeps of a file being written that were not copied yet and whose data and quality
+      datasets all have /where/nrays rows. The file is opened for SWMR reading each time, so the
+      extents are current.
+   @param fileName Name of the file in the input folder.
+   @param volume The image of the file.
+   @param last True if the writer closed the file, then the top level groups are copied too.
+*/
+void HoofAssembler::_grow(const string& fileName, Volume& volume, bool last) const
+{
+   HoofTrace::Scope scope("Grow volume", "stage");
+   HoofH5File file(HoofArchive::diskPath(fileName), "swmr");
+   for(const string& dataset : file.getDatasets())
+   {
+      if(volume.copied.count(dataset))
+         continue;
+      optional<int> nrays = file.getAtt<int>("/" + dataset + "/where", "nrays");
+      bool complete = nrays.has_value();
+      for(const string type : {"data", "quality"})
+      {
+         for(const string& data : file.getDatas("/" + dataset, type))
+         {
+            vector<hsize_t> extent = file.getExtent("/" + dataset + "/" + data, "data");
+            complete = complete && !extent.empty() && extent[0] >= nrays.value();
+         }
+      }
+      if(!complete)
+      {
+         if(last)
+            cout << "Sweep " << dataset << " of " << fileName << " is incomplete, leaving it out" << endl;
+         continue;
+      }
+      file.copyDataset(volume.file, "/" + dataset, "/" + dataset);
+      volume.copied.insert(dataset);
+      volume.newest = std::time(nullptr);
+   }
+   if(last)
+   {
+      file.copyAttributes(volume.file, "/");
+      for(const string group : {"what", "where", "how"})
+      {
+         if(file.hasDataset("/", group))
+            file.copyDataset(volume.file, "/" + group, "/" + group);
+      }
+   }
+   file.close();
+}
+
+/**
+   @brief Checks if a volume has all expected elevations of its site.
+   @param volume The volume.
+   @return True if all expected elevations were received, false if some are missing or none are expected.
+*/
+bool HoofAssembler::_complete(const Volume& volume) const
+{
+   auto expected = HoofSettings::expectedElevations.find(volume.site);
+   if(expected == HoofSettings::expectedElevations.end())
+      return false;
+   for(double elangle : expected->second)
+   {
+      if(std::none_of(volume.elangles.begin(), volume.elangles.end(),
+         [&](double received) { return std::abs(received - elangle) < 0.05; }))
+         return false;
+   }
+   return true;
+}
+
+/**
+   @brief Renames the sweeps to datasets ordered by elevation and start time and hands the volume image to HoofArchive.
+   @param name Name of the volume.
+   @param volume The volume.
+*/
+void HoofAssembler::_finish(const string& name, Volume& volume) const
+{
+   HoofTrace::Scope scope("Finish volume", "stage");
+   vector<int> order(volume.elangles.size());
+   std::iota(order.begin(), order.end(), 0);
+   std::stable_sort(order.begin(), order.end(),
+      [&](int a, int b) { return std::make_pair(volume.elangles[a], volume.starts[a]) <
+         std::make_pair(volume.elangles[b], volume.starts[b]); });
+   for(int i=0; i<order.size(); i++)
+      volume.file.moveGroup("/sweep" + std::to_string(order[i] + 1), "/dataset" + std::to_string(i + 1));
+   HoofArchive::addAssembled(name, volume.file.image());
+   volume.file.close();
+}
+
+/**
+   @brief Finishes the volumes that have all expected elevations or whose newest sweep arrived more than
+      [Scan timeout in s] ago, and the files being written whose writer closed them or did not complete a
+      sweep for [Scan timeout in s].
+   @return Names of the finished volumes, to be processed as input files.
+*/
+vector<string> HoofAssembler::ready()
+{
+   vector<string> names;
+   std::time_t now = std::time(nullptr);
+   for(auto it = _volumes.begin(); it != _volumes.end(); )
+   {
+      bool complete = _complete(it->second);
+      if(!complete && std::difftime(now, it->second.newest) < HoofSettings::scanTimeout)
+      {
+         it++;
+         continue;
+      }
+      if(!complete)
+         cout << "Volume " << it->first << " timed out with " << it->second.elangles.size() << " sweeps" << endl;
+      _finished.insert(it->first);
+      try
+      {
+         _finish(it->first, it->second);
+         names.push_back(it->first);
+      }
+      catch(...)
+      {
+         cout << "Could not assemble volume " << it->first << endl;
+      }
+      it = _volumes.erase(it);
+   }
+
+   // files being written are handed over when their writer closed them or stopped writing sweeps
+   for(auto it = _growing.begin(); it != _growing.end(); )
+   {
+      bool writing = HoofH5File::writing(HoofArchive::diskPath(it->first));
+      bool stalled = writing && std::difftime(now, it->second.newest) >= HoofSettings::scanTimeout;
+      try
+      {
+         _grow(it->first, it->second, !writing || stalled);
+         if(writing && !stalled)
+         {
+            it++;
+            continue;
+         }
+         if(stalled)
+            cout << it->first << " got no complete sweep for " << HoofSettings::scanTimeout <<
+               " s, processing the sweeps it has" << endl;
+         HoofArchive::addAssembled(it->first, it->second.file.image());
+      }
+      catch(...)
+      {
+         if(writing && !stalled)
+         {
+            it++;
+            continue;
+         }
+         cout << "Could not read the sweeps of " << it->first << " while it was written" << endl;
+      }
+      names.push_back(it->first);
+      it->second.file.close();
+      it = _growing.erase(it);
+   }
+   return names;
+}
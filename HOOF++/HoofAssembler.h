@@ -0,0 +1,78 @@
+/**
+   @file HoofAssembler.h
+   @author Peter Smerkol
+   @brief Contains definition of HoofAssembler class.
+*/
+
+#ifndef HOOFASSEMBLER_GUARD
+#define HOOFASSEMBLER_GUARD
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <ctime>
+#include <HoofH5File.h>
+
+/**
+   @class HoofAssembler
+   @brief Class that assembles volumes from SCAN files that hold one sweep each.
+
+   SCAN files are grouped into volumes by the radar site and the nominal time in /what. The sweep of each
+   SCAN file is copied into its volume, which is built in memory, as soon as the file is added, so reading
+   the SCAN files, and extracting archived ones, is done while the rest of the volume arrives. The sweeps
+   are copied with their compressed chunks as they are, they are decompressed when the volume is
+   processed. A volume is finished when it has all [Expected elevations] of its site, or [Scan timeout in
+   s] after its newest sweep arrived. A finished volume gets its sweeps as datasets ordered by elevation
+   and start time and is handed to HoofArchive as a file image, so it is processed like any other input
+   file. Sweeps of a volume that was already finished are dropped, they would overwrite its output.
+
+   With [SWMR input], input files that another process is still writing in SWMR mode are followed the
+   same way: each sweep is copied into the image as soon as all its data have their full number of rays,
+   and the file is handed to HoofArchive under its own name when the writer closes it, or when no sweep
+   was completed for [Scan timeout in s].
+*/
+class HoofAssembler
+{
+   private:
+      /**
+         @struct Volume
+         @brief Holds one volume being assembled.
+      */
+      struct Volume
+      {
+         std::string site;                 ///< Radar site.
+         HoofH5File file;                  ///< The volume, built in memory.
+         std::vector<double> elangles;     ///< Elevation angles of the sweeps in degrees, in arrival order.
+         std::vector<std::string> starts;  ///< Start date and time of the sweeps, in arrival order.
+         std::time_t newest;               ///< Arrival time of the newest sweep.
+         std::set<std::string> copied;     ///< Datasets already copied from a file still being written.
+      };
+
+      // members
+      std::map<std::string, Volume> _volumes;   ///< Volumes being assembled, by name.
+      std::map<std::string, Volume> _growing;   ///< Files still being written, by name.
+      std::set<std::string> _finished;          ///< Names of the volumes already finished.
+
+      // checks if a volume has all expected elevations of its site
+      bool _complete(const Volume& volume) const;
+      // orders the sweeps and hands the volume image to HoofArchive
+      void _finish(const std::string& name, Volume& volume) const;
+      // copies the complete sweeps of a file being written that were not copied yet
+      void _grow(const std::string& fileName, Volume& volume, bool last) const;
+
+   public:
+      // adds a file to its volume if it is a SCAN file
+      bool add(const std::string& fileName);
+      // finishes the volumes that are complete or timed out and the files whose writer closed them,
+      // and returns their names
+      std::vector<std::string> ready();
+      // follows a file if it is still being written in SWMR mode
+      bool follow(const std::string& fileName);
+      // gets the number of volumes still waiting for sweeps
+      int pending() const { return _volumes.size(); }
+      // gets the number of files still being written
+      int growing() const { return _growing.size(); }
+};
+
+#endif // HOOFASSEMBLER_GUARD
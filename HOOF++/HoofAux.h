@@ -15,6 +15,7 @@
 #include <type_traits>
 #include <optional>
 #include <limits>
+#include <ctime>
 #include <unordered_set>
 #include <HoofTypes.h>
 
@@ -151,6 +152,24 @@ class HoofAux
          t.erase(remove_if(t.begin(), t.end(), [](unsigned char c) { return isdigit(c);}), t.end());
          return t;
       }
+
+      /**
+         @brief Converts a UTC date and time to seconds since the epoch.
+         @param datetime Date and time as YYYYMMDDhhmm or YYYYMMDDhhmmss.
+         @return Seconds since the epoch.
+      */
+      static std::time_t toTime(const std::string& datetime)
+      {
+         std::tm t = {};
+         t.tm_year = to<int>(datetime.substr(0,4)) - 1900;
+         t.tm_mon = to<int>(datetime.substr(4,2)) - 1;
+         t.tm_mday = to<int>(datetime.substr(6,2));
+         t.tm_hour = to<int>(datetime.substr(8,2));
+         t.tm_min = to<int>(datetime.substr(10,2));
+         if(datetime.size() >= 14)
+            t.tm_sec = to<int>(datetime.substr(12,2));
+         return timegm(&t);
+      }
       
       /**
          @brief Finds an element in a vector of type T.
@@ -376,13 +395,13 @@ class HoofAux
       }
 
       /**
-         @brief Fills an array with subset of values from a 3D double vector, where the subset
+         @brief Fills a double array with subset of values from a 3D vector, where the subset
             indexes are given in a vector<Triple>.
          @param vec The 3D vector from which to get the values.
          @param idxs The vector<Triple> from which to get the indexes for the subset.
          @param arr The array to fill with the subset.
       */
-      static void subset(const hoof::vector3D<double>& vec,
+      template<typename T> static void subset(const hoof::vector3D<T>& vec,
          const std::vector<hoof::Triple>& idxs, double* arr, std::size_t size)
       {
          for(int i=0; i<size; i++)
@@ -0,0 +1,182 @@
+/**
+   @file HoofCApi.cpp
+   @author Peter Smerkol
+   @brief Contains the implementation of the C interface of HOOF.
+*/
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstring>
+#include <HoofTypes.h>
+#include <HoofSettings.h>
+#include <HoofData.h>
+#include <HoofProcessor.h>
+#include <HoofIOThread.h>
+#include <HoofLog.h>
+#include <HoofCApi.h>
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::endl;
+using namespace hoof;
+
+/**
+   @struct hoof_handle
+   @brief Holds one opened HOOF instance.
+*/
+struct hoof_handle
+{
+   HoofProcessor processor;   ///< Processor of the files.
+   HoofData data;             ///< Data of the last processed file.
+   bool hasData;              ///< Flag if a file was processed successfully.
+};
+
+/**
+   @brief Gets the superobed DBZ or VRAD measurement of the last processed file.
+   @param handle The HOOF instance.
+   @param quantity "DBZ" or "VRAD".
+   @return The superobed measurement, or nullptr if there is none.
+*/
+static const HoofMeasurement* superobs(const hoof_handle* handle, const char* quantity)
+{
+   if(handle == nullptr || quantity == nullptr || !handle->hasData || !HoofSettings::superobing)
+      return nullptr;
+   const HoofMeasurement* m = nullptr;
+   if(strcmp(quantity, "DBZ") == 0)
+      m = &handle->data.sdbz;
+   if(strcmp(quantity, "VRAD") == 0)
+      m = &handle->data.svrad;
+   if(m == nullptr || m->meas.empty())
+      return nullptr;
+   return m;
+}
+
+/**
+   @brief Reads the namelist and opens a HOOF instance.
+   @param namelist Path of the namelist file.
+   @param inFolder Folder with the input files, with a trailing slash.
+   @param outFolder Folder for the output files, with a trailing slash.
+   @return The handle, or NULL if the namelist could not be read.
+*/
+hoof_handle* hoof_open(const char* namelist, const char* inFolder, const char* outFolder)
+{
+   try
+   {
+      HoofSettings settings(namelist, inFolder, outFolder);
+
+      // same fallbacks as HOOF2, files are processed in the calling process
+      if(HoofSettings::outputMode == "SUPEROBS" && !HoofSettings::superobing)
+         HoofSettings::outputMode = "PLANNED";
+      if(HoofSettings::writeBehind && !HoofIOThread::available())
+         HoofSettings::writeBehind = false;
+
+      hoof_handle* handle = new hoof_handle();
+      handle->hasData = false;
+      return handle;
+   }
+   catch(const std::exception& e)
+   {
+      cout << "Could not open HOOF: " << e.what() << endl;
+   }
+   catch(...)
+   {
+      cout << "Could not open HOOF" << endl;
+   }
+   return nullptr;
+}
+
+/**
+   @brief Processes one file from the input folder and keeps its data for hoof_get_superobs.
+   @param handle The HOOF instance.
+   @param fileName Name of the file in the input folder.
+   @return 0 on success, 1 if processing failed.
+*/
+int hoof_process_file(hoof_handle* handle, const char* fileName)
+{
+   if(handle == nullptr || fileName == nullptr)
+      return 1;
+   handle->hasData = false;
+   try
+   {
+      handle->hasData = handle->processor.process(fileName, &handle->data);
+   }
+   catch(...)
+   {
+      cout << "Could not process file " << fileName << endl;
+   }
+   return handle->hasData ? 0 : 1;
+}
+
+/**
+   @brief Gets the dimensions of the superobs of the last processed file.
+   @param handle The HOOF instance.
+   @param quantity "DBZ" or "VRAD".
+   @param nel Returns the number of elevations.
+   @param naz Returns the maximum number of azimuths.
+   @param nr Returns the maximum number of range bins.
+   @return 0 on success, 1 if there are no superobs of the quantity.
+*/
+int hoof_get_superob_dims(hoof_handle* handle, const char* quantity, int* nel, int* naz, int* nr)
+{
+   const HoofMeasurement* m = superobs(handle, quantity);
+   *nel = m == nullptr ? 0 : m->nel;
+   *naz = m == nullptr ? 0 : m->nazMax;
+   *nr = m == nullptr ? 0 : m->nrMax;
+   return m == nullptr ? 1 : 0;
+}
+
+/**
+   @brief Copies the superobs of the last processed file into buffers of the caller, sized with
+      hoof_get_superob_dims. Any of the buffers can be NULL if it is not needed.
+   @param handle The HOOF instance.
+   @param quantity "DBZ" or "VRAD".
+   @param values Buffer of nel*naz*nr superobed values.
+   @param quality Buffer of nel*naz*nr superobed qualities.
+   @param elangles Buffer of nel elevation angles in radians.
+   @param azimuths Buffer of nel*naz azimuths in radians.
+   @param ranges Buffer of nel*nr bin ranges in meters.
+   @return 0 on success, 1 if there are no superobs of the quantity.
+*/
+int hoof_get_superobs(hoof_handle* handle, const char* quantity, double* values, double* quality,
+   double* elangles, double* azimuths, double* ranges)
+{
+   const HoofMeasurement* m = superobs(handle, quantity);
+   if(m == nullptr)
+      return 1;
+
+   int nel = m->nel;
+   int naz = m->nazMax;
+   int nr = m->nrMax;
+   for(int i=0; i<nel; i++)
+   {
+      if(elangles != nullptr)
+         elangles[i] = m->elangles[i];
+      if(azimuths != nullptr)
+         std::copy(m->azimuths[i].begin(), m->azimuths[i].end(), azimuths + i*naz);
+      if(ranges != nullptr)
+         std::copy(m->ranges[i].begin(), m->ranges[i].end(), ranges + i*nr);
+      for(int j=0; j<naz; j++)
+      {
+         if(values != nullptr)
+            std::copy(m->meas[i][j].begin(), m->meas[i][j].end(), values + (i*naz + j)*nr);
+         if(quality != nullptr)
+            std::copy(m->quals[i][j].begin(), m->quals[i][j].end(), quality + (i*naz + j)*nr);
+      }
+   }
+   return 0;
+}
+
+/**
+   @brief Waits until all output and log records are written and frees the handle.
+   @param handle The HOOF instance.
+*/
+void hoof_free(hoof_handle* handle)
+{
+   if(handle == nullptr)
+      return;
+   handle->processor.flush();
+   HoofLog::stop();
+   delete handle;
+}
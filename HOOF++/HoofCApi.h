@@ -0,0 +1,41 @@
+/**
+   @file HoofCApi.h
+   @author Peter Smerkol
+   @brief Contains the C interface of HOOF, for calling it from C and Fortran (see hoof_mod.F90).
+
+   A handle parses the namelist once and processes files one by one in the calling process. The output
+   files are written as with HOOF2, and the superobs of the last processed file are copied into buffers
+   of the caller, so assimilation code does not need to start HOOF2 and read its output back.
+
+   Arrays are filled in C order (el, az, r), which is a Fortran array (nr, naz, nel). Elevations with
+   fewer azimuths or bins than the maximum are padded with NaN. HOOF settings are global, so only one
+   handle can be open at a time.
+*/
+
+#ifndef HOOFCAPI_GUARD
+#define HOOFCAPI_GUARD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// opaque handle of an opened HOOF instance
+typedef struct hoof_handle hoof_handle;
+
+// reads the namelist and opens a HOOF instance, returns NULL on failure
+hoof_handle* hoof_open(const char* namelist, const char* inFolder, const char* outFolder);
+// processes one file from the input folder, returns 0 on success
+int hoof_process_file(hoof_handle* handle, const char* fileName);
+// gets the dimensions of the DBZ or VRAD superobs of the last processed file, returns 0 on success
+int hoof_get_superob_dims(hoof_handle* handle, const char* quantity, int* nel, int* naz, int* nr);
+// copies the DBZ or VRAD superobs, their quality and coordinates into caller buffers, returns 0 on success
+int hoof_get_superobs(hoof_handle* handle, const char* quantity, double* values, double* quality,
+   double* elangles, double* azimuths, double* ranges);
+// waits for pending output, closes the HOOF instance and frees the handle
+void hoof_free(hoof_handle* handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOOFCAPI_GUARD
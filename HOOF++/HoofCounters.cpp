@@ -0,0 +1,204 @@
+/**
+   @file HoofCounters.cpp
+   @author Peter Smerkol
+   @brief Contains the HoofCounters class implementation.
+*/
+
+#include <string>
+#include <array>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <HoofSettings.h>
+#include <HoofCounters.h>
+
+using std::string;
+using std::array;
+using std::cout;
+using std::endl;
+
+// --- initialize static members
+const array<string, HoofCounters::nCounters> HoofCounters::names =
+   {"cycles", "instructions", "cache_misses", "branch_misses", "page_faults"};
+
+/**
+   @brief Formats a number with an SI prefix, e.g. 1.23 G.
+   @param value The number.
+   @return The formatted number.
+*/
+static string si(double value)
+{
+   const char* prefixes[] = {"", " k", " M", " G", " T"};
+   int p = 0;
+   while(value >= 1000.0 && p < 4)
+   {
+      value /= 1000.0;
+      p++;
+   }
+   char text[32];
+   snprintf(text, sizeof(text), p == 0 ? "%.0f%s" : "%.2f%s", value, prefixes[p]);
+   return text;
+}
+
+/**
+   @brief Constructor, opens each counter for the calling thread in user space, if counters are
+      enabled in the namelist. Counters that can not be opened are left out.
+*/
+HoofCounters::HoofCounters()
+{
+   _fds.fill(-1);
+   if(!HoofSettings::hardwareCounters)
+      return;
+
+   const array<std::uint32_t, nCounters> types = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+      PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE};
+   const array<std::uint64_t, nCounters> configs = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_SW_PAGE_FAULTS};
+   for(int i=0; i<nCounters; i++)
+   {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = types[i];
+      attr.config = configs[i];
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      _fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+   }
+}
+
+/**
+   @brief Destructor, closes the counters.
+*/
+HoofCounters::~HoofCounters()
+{
+   for(int i=0; i<nCounters; i++)
+   {
+      if(_fds[i] >= 0)
+         close(_fds[i]);
+   }
+}
+
+/**
+   @brief Checks if at least one counter could be opened.
+   @return True if a counter is available, false otherwise.
+*/
+bool HoofCounters::available() const
+{
+   for(int i=0; i<nCounters; i++)
+   {
+      if(_fds[i] >= 0)
+         return true;
+   }
+   return false;
+}
+
+/**
+   @brief Reads all counters. Counts of counters that shared the hardware with others are scaled
+      to the whole time they were enabled.
+   @return The counter values, -1 for counters that are not available.
+*/
+HoofCounters::Sample HoofCounters::read() const
+{
+   Sample sample;
+   sample.fill(-1);
+   for(int i=0; i<nCounters; i++)
+   {
+      std::uint64_t values[3];
+      if(_fds[i] < 0 || ::read(_fds[i], values, sizeof(values)) != sizeof(values))
+         continue;
+      double count = (double)values[0];
+      if(values[2] > 0 && values[2] < values[1])
+         count *= (double)values[1] / (double)values[2];
+      sample[i] = (long long)count;
+   }
+   return sample;
+}
+
+/**
+   @brief Formats the counter differences between two readings for the console, with the
+      instructions per cycle if both are available.
+   @param before The reading at the start of a stage.
+   @param after The reading at the end of a stage.
+   @return The formatted counters, empty if no counter is available.
+*/
+string HoofCounters::format(const Sample& before, const Sample& after)
+{
+   string text;
+   for(int i=0; i<nCounters; i++)
+   {
+      if(before[i] < 0 || after[i] < 0)
+         continue;
+      string name = names[i];
+      std::replace(name.begin(), name.end(), '_', ' ');
+      text += (text.empty() ? "" : ", ") + si((double)(after[i] - before[i])) + " " + name;
+      if(i == 1 && before[0] >= 0 && after[0] > before[0])
+      {
+         char ipc[32];
+         snprintf(ipc, sizeof(ipc), ", %.2f IPC", (double)(after[1] - before[1]) / (double)(after[0] - before[0]));
+         text += ipc;
+      }
+   }
+   return text.empty() ? text : "   [" + text + "]";
+}
+
+/**
+   @brief Formats the counter differences between two readings as CSV fields.
+   @param before The reading at the start of a stage.
+   @param after The reading at the end of a stage.
+   @return Comma separated counter differences, empty fields for counters that are not available.
+*/
+string HoofCounters::csv(const Sample& before, const Sample& after)
+{
+   string fields;
+   for(int i=0; i<nCounters; i++)
+   {
+      if(i > 0)
+         fields += ",";
+      if(before[i] >= 0 && after[i] >= 0)
+         fields += std::to_string(after[i] - before[i]);
+   }
+   return fields;
+}
+
+/**
+   @brief Creates the CSV file in the output folder, replacing the one from a previous run, and writes
+      the header.
+*/
+void HoofCounters::startCsv()
+{
+   string header = "file,stage,ms";
+   for(int i=0; i<nCounters; i++)
+      header += "," + names[i];
+   int fd = open((HoofSettings::outFolder + HoofSettings::countersFile).c_str(),
+      O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   header += "\n";
+   if(fd < 0 || write(fd, header.c_str(), header.size()) < 0)
+      cout << "Could not write " << HoofSettings::outFolder + HoofSettings::countersFile << endl;
+   if(fd >= 0)
+      close(fd);
+}
+
+/**
+   @brief Appends lines to the CSV file with a single write on a descriptor opened with O_APPEND, so
+      lines of worker processes writing at the same time are not mixed.
+   @param lines The lines to append.
+*/
+void HoofCounters::appendCsv(const string& lines)
+{
+   if(lines.empty())
+      return;
+   int fd = open((HoofSettings::outFolder + HoofSettings::countersFile).c_str(),
+      O_WRONLY | O_CREAT | O_APPEND, 0644);
+   if(fd < 0 || write(fd, lines.c_str(), lines.size()) < 0)
+      cout << "Could not write " << HoofSettings::outFolder + HoofSettings::countersFile << endl;
+   if(fd >= 0)
+      close(fd);
+}
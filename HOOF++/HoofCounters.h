@@ -0,0 +1,53 @@
+/**
+   @file HoofCounters.h
+   @author Peter Smerkol
+   @brief Contains definition of HoofCounters class.
+*/
+
+#ifndef HOOFCOUNTERS_GUARD
+#define HOOFCOUNTERS_GUARD
+
+#include <string>
+#include <array>
+
+/**
+   @class HoofCounters
+   @brief Class that reads hardware performance counters of the calling thread with perf_event_open.
+
+   Counts cycles, instructions, cache misses, branch misses and page faults in user space. Each counter
+   is opened on its own, so counters that are not available (e.g. hardware counters in containers or
+   with a restrictive perf_event_paranoid) are left out and the others still work.
+*/
+class HoofCounters
+{
+   public:
+      // number of counters
+      static const int nCounters = 5;
+      // one reading of all counters, -1 for counters that are not available
+      using Sample = std::array<long long, nCounters>;
+      // names of the counters, as used in the CSV header
+      static const std::array<std::string, nCounters> names;
+
+      // constructor, opens the counters if enabled in the namelist
+      HoofCounters();
+      // destructor, closes the counters
+      ~HoofCounters();
+      // checks if at least one counter is available
+      bool available() const;
+      // reads all counters
+      Sample read() const;
+      // formats the counter differences between two readings for the console
+      static std::string format(const Sample& before, const Sample& after);
+      // formats the counter differences between two readings as CSV fields
+      static std::string csv(const Sample& before, const Sample& after);
+      // creates the CSV file in the output folder and writes its header
+      static void startCsv();
+      // appends lines to the CSV file in one write, so worker processes do not mix their lines
+      static void appendCsv(const std::string& lines);
+
+   private:
+      // members
+      std::array<int, nCounters> _fds;   ///< File descriptors of the counters, -1 if not available.
+};
+
+#endif // HOOFCOUNTERS_GUARD
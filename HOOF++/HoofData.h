@@ -26,7 +26,6 @@ struct HoofData
    std::vector<double> zStarts;        ///< Start heights of height sectors in dealiasing.
    std::vector<double> zEnds;          ///< End heights of height sectors in dealiasing.
    hoof::vector2D<hoof::Triple> zIdxs; ///< Array of (el, az, r) indexes for each height sector that are good for dealiasing.
-   hoof::vector3D<double> wModels;     ///< Values of dealiasing wind model for all (el, az, r).
    hoof::vector3D<int> ns;             ///< Deailiasing Nyquist multipliers for all (el, az, r). 
    hoof::vector3D<double> dvrads;      ///< Dealiased VRAD values for all (el, az, r).
    HoofMeasurement sdbz;               ///< All data from superobed DBZ measurements.
@@ -8,6 +8,9 @@
 #include <vector>
 #include <array>
 #include <set>
+#include <map>
+#include <optional>
+#include <ctime>
 #include <iostream>
 #include <cmath>
 #include <algorithm>
@@ -33,14 +36,19 @@ using std::endl;
 using std::abs;
 using std::min_element;
 using std::isnan;
+using std::optional;
 using namespace hoof;
 
+// --- initialize static members
+template<typename T> std::map<string, typename HoofDealiaser<T>::Profile> HoofDealiaser<T>::_profiles;
+
 /**
    @brief Constructor.
    @param data A HoofData object to fill to be used later in dealiasing and superobing.
    @param outFile The output file.
 */
-HoofDealiaser::HoofDealiaser(HoofData& data, HoofH5File& outFile) :
+template<typename T>
+HoofDealiaser<T>::HoofDealiaser(HoofData& data, HoofH5File& outFile) :
    _outFile(outFile), _data(data)
 {
    classMessage = "Dealiasing";
@@ -49,49 +57,54 @@ HoofDealiaser::HoofDealiaser(HoofData& data, HoofH5File& outFile) :
 /**
    @brief Checks VRAD data if it exists and is not NaN everywhere.
 */
-void HoofDealiaser::checkData()
+template<typename T>
+void HoofDealiaser<T>::checkData()
 {
    if(_data.vrad.datasets.size() == 0)
-      error("no VRAD datasets in file");
+      error("NO_VRAD", "no VRAD datasets in file");
    
    if(HoofAux::isallnan(_data.vrad.meas))
-      error("all data in VRAD datasets are NaN");
+      error("VRAD_ALL_NAN", "all data in VRAD datasets are NaN");
 }
 
 /**
    @brief Calculates quantities used in minimzation to get the wind model.
 */
-void HoofDealiaser::calculateWindModelQtys()
+template<typename T>
+void HoofDealiaser<T>::calculateWindModelQtys()
 {
    // initialize with NaNs
    int nel = _data.vrad.nel;
    int naz = _data.vrad.nazMax;
    int nr = _data.vrad.nrMax;
-   double Pi = HoofAux::Pi;
-   _As = vector3D<double>(nel, vector2D<double>(naz, vector<double>(nr, dNaN)));
-   _Bs = vector3D<double>(nel, vector2D<double>(naz, vector<double>(nr, dNaN)));
-   _Ds = vector3D<double>(nel, vector2D<double>(naz, vector<double>(nr, dNaN)));
-   _cosEls = vector<double>(nel, dNaN);
-   _cosAzs = vector2D<double>(nel, vector<double>(naz, dNaN));
-   _sinAzs = vector2D<double>(nel, vector<double>(naz, dNaN));   
-   vector3D<double> f3s(nel, vector2D<double>(naz, vector<double>(nr, dNaN)));
+   T Pi = HoofAux::Pi;
+   T nan = dNaN;
+   _meas = vector3D<T>(nel, vector2D<T>(naz, vector<T>(nr, nan)));
+   _As = vector3D<T>(nel, vector2D<T>(naz, vector<T>(nr, nan)));
+   _Bs = vector3D<T>(nel, vector2D<T>(naz, vector<T>(nr, nan)));
+   _Ds = vector3D<T>(nel, vector2D<T>(naz, vector<T>(nr, nan)));
+   _cosEls = vector<T>(nel, nan);
+   _cosAzs = vector2D<T>(nel, vector<T>(naz, nan));
+   _sinAzs = vector2D<T>(nel, vector<T>(naz, nan));   
+   vector3D<T> f3s(nel, vector2D<T>(naz, vector<T>(nr, nan)));
 
    // calculate A, B and F3 quantities and get the minimum Nyquist velocity
    _vnyMin = std::numeric_limits<double>::infinity();
    for(int i=0; i<nel; i++)
    {
-      _cosEls[i] = cos(_data.vrad.elangles[i]);
-      double vNy = _data.vrad.vnys[i];
-      if(vNy < _vnyMin)
-         _vnyMin = vNy;
+      _cosEls[i] = cos((T)_data.vrad.elangles[i]);
+      T vNy = _data.vrad.vnys[i];
+      if(_data.vrad.vnys[i] < _vnyMin)
+         _vnyMin = _data.vrad.vnys[i];
       for(int j=0; j<_data.vrad.naz[i]; j++)
       {
-         double az = _data.vrad.azimuths[i][j];
+         T az = _data.vrad.azimuths[i][j];
          _cosAzs[i][j] = cos(az);
          _sinAzs[i][j] = sin(az);
          for(int k=0; k<_data.vrad.nr[i]; k++)
          {
-            double meas = _data.vrad.meas[i][j][k];
+            T meas = _data.vrad.meas[i][j][k];
+            _meas[i][j][k] = meas;
             _As[i][j][k] = _cosEls[i]*_cosAzs[i][j]*sin(Pi*meas/vNy);
             _Bs[i][j][k] = _cosEls[i]*_sinAzs[i][j]*sin(Pi*meas/vNy);
             f3s[i][j][k] = vNy*cos(Pi*meas/vNy)/Pi;
@@ -108,7 +121,7 @@ void HoofDealiaser::calculateWindModelQtys()
          // roll the azimuth and f3 matrices for derivative calculation
          int nextj = j+1 == azSize ? 0 : j+1;
          int prevj = j-1 == -1 ? azSize-1 : j-1;
-         double daz = _data.vrad.azimuths[i][nextj] - _data.vrad.azimuths[i][prevj];
+         T daz = _data.vrad.azimuths[i][nextj] - _data.vrad.azimuths[i][prevj];
          if(j == 0 || j == azSize-1)
             daz = daz - 2*Pi;
          // calculate D from derivative   
@@ -121,7 +134,8 @@ void HoofDealiaser::calculateWindModelQtys()
 /**
    @brief Determines the height sectors in which to run the wind model.
 */
-void HoofDealiaser::determineHeightSectors()
+template<typename T>
+void HoofDealiaser<T>::determineHeightSectors()
 {
    // prepare variables
    double dz = HoofSettings::zSectorSize;
@@ -157,67 +171,242 @@ void HoofDealiaser::determineHeightSectors()
 }
 
 /**
-   @brief Calculates wind models for all height sectors.
+   @brief Gets the wind profile of the previous volume of the site, if warm start is enabled, the volumes
+      are at most [Warm start maximum age in minutes] apart and the height sectors are the same.
+   @param start Start time of the first VRAD sweep of this volume.
+   @return The profile, or nullptr if there is none to use.
+*/
+template<typename T>
+const typename HoofDealiaser<T>::Profile* HoofDealiaser<T>::_previousProfile(optional<std::time_t> start) const
+{
+   if(!HoofSettings::warmStart || !start)
+      return nullptr;
+   auto it = _profiles.find(_data.site);
+   if(it == _profiles.end())
+      return nullptr;
+   const Profile& profile = it->second;
+   if(abs(std::difftime(start.value(), profile.start)) > 60.0*HoofSettings::warmStartMaxAge ||
+      !HoofAux::eqDbl(profile.zStart, _data.height) || !HoofAux::eqDbl(profile.dz, HoofSettings::zSectorSize))
+      return nullptr;
+   return &profile;
+}
+
+/**
+   @brief Takes an evenly spaced sample of the good points of a height sector. The points are ordered by
+      elevation, azimuth and range, so the sample covers all elevations and azimuths of the sector in
+      proportion to their points, and the same points are taken for the same data.
+   @param idxs Indexes (el, az, r) of the good points in the sector.
+   @param n Size of the sample, smaller than the number of points.
+   @return Indexes of the sampled points.
+*/
+template<typename T>
+vector<Triple> HoofDealiaser<T>::_sample(const vector<Triple>& idxs, int n) const
+{
+   vector<Triple> sample(n);
+   double step = (double)idxs.size()/(double)n;
+   for(int i=0; i<n; i++)
+      sample[i] = idxs[(size_t)(i*step)];
+   return sample;
+}
+
+/**
+   @brief Fits the wind model of a height sector to the A, B and D of its good points with gsl_multifit.
+   @param idxs Indexes (el, az, r) of the points to fit.
+   @param u Fitted u.
+   @param v Fitted v.
+   @return RMS residual of D in m/s.
+*/
+template<typename T>
+double HoofDealiaser<T>::_fit(const vector<Triple>& idxs, double& u, double& v) const
+{
+   // get the A, B and D for current height level
+   int nidxs = idxs.size();
+   vector<double> As(nidxs);
+   vector<double> Bs(nidxs);
+   vector<double> Ds(nidxs);
+   HoofAux::subset(_As, idxs, As.data(), nidxs);
+   HoofAux::subset(_Bs, idxs, Bs.data(), nidxs);
+   HoofAux::subset(_Ds, idxs, Ds.data(), nidxs);
+
+   // use gsl_multifit to fit the curve to A,B and D and get u and v of the wind model
+   gsl_matrix *X = gsl_matrix_alloc(nidxs, 2);
+   gsl_vector *y = gsl_vector_alloc(nidxs);
+   gsl_vector *c = gsl_vector_alloc(2);
+   gsl_matrix *cov = gsl_matrix_alloc(2, 2);
+   for(int j=0; j<nidxs; j++)
+   {
+      gsl_matrix_set(X, j, 0, -As[j]);
+      gsl_matrix_set(X, j, 1, Bs[j]);
+      gsl_vector_set(y, j, Ds[j]);
+   }
+   double chisq;
+   gsl_multifit_linear_workspace *work = gsl_multifit_linear_alloc(nidxs, 2);
+   gsl_multifit_linear(X, y, c, cov, &chisq, work);
+   u = gsl_vector_get(c, 0);
+   v = gsl_vector_get(c, 1);
+   gsl_multifit_linear_free(work);
+   gsl_matrix_free(X);
+   gsl_matrix_free(cov);
+   gsl_vector_free(y);
+   gsl_vector_free(c);
+   return std::sqrt(chisq/nidxs);
+}
+
+/**
+   @brief Fits the wind model of a height sector with the wind of the previous profile as a prior. The
+      2x2 normal equations are solved directly, the prior enters them like [Warm start weight] average
+      good points that measure it.
+   @param idxs Indexes (el, az, r) of the points to fit.
+   @param u0 u of the sector in the previous profile.
+   @param v0 v of the sector in the previous profile.
+   @param u Fitted u.
+   @param v Fitted v.
 */
-void HoofDealiaser::calculateWindModels()
+template<typename T>
+void HoofDealiaser<T>::_fitWithPrior(const vector<Triple>& idxs, double u0, double v0, double& u, double& v) const
+{
+   int n = idxs.size();
+
+   // normal equations of D = -A u + B v
+   double aa = 0.0, ab = 0.0, bb = 0.0, ad = 0.0, bd = 0.0;
+   for(int i=0; i<n; i++)
+   {
+      double a = _As[idxs[i][0]][idxs[i][1]][idxs[i][2]];
+      double b = _Bs[idxs[i][0]][idxs[i][1]][idxs[i][2]];
+      double d = _Ds[idxs[i][0]][idxs[i][1]][idxs[i][2]];
+      aa += a*a;
+      ab += a*b;
+      bb += b*b;
+      ad += a*d;
+      bd += b*d;
+   }
+
+   // the prior counts like [Warm start weight] average points on the diagonal
+   double w = n > 0 ? HoofSettings::warmStartWeight*(aa + bb)/(2.0*n) : 1.0;
+   double m00 = aa + w;
+   double m01 = -ab;
+   double m11 = bb + w;
+   double r0 = -ad + w*u0;
+   double r1 = bd + w*v0;
+   double det = m00*m11 - m01*m01;
+   u = (m11*r0 - m01*r1)/det;
+   v = (m00*r1 - m01*r0)/det;
+}
+
+/**
+   @brief Calculates wind models for all height sectors. With [Warm start dealiasing], sectors that had a
+      model in the previous volume of the site are fitted with it as a prior, or take it as their model if
+      they have fewer than [Warm start minimum good points], and this volume's fits are kept for the next.
+*/
+template<typename T>
+void HoofDealiaser<T>::calculateWindModels()
 {
    // prepare variables
    int nel = _data.vrad.nel;
    int naz = _data.vrad.nazMax;
    int nr = _data.vrad.nrMax;
    double vmax = HoofSettings::maxWind;
-   _data.wModels = vector3D<double>(nel, vector2D<double>(naz, vector<double>(nr, dNaN)));
+   _wModels = vector3D<T>(nel, vector2D<T>(naz, vector<T>(nr, (T)dNaN)));
+
+   // get the wind profile of the previous volume of the site, volumes are timed by their first VRAD sweep
+   optional<std::time_t> start = std::nullopt;
+   if(HoofSettings::warmStart)
+   {
+      optional<string> date = _outFile.getAtt<string>(_data.vrad.datasets[0] + "/what", "startdate");
+      optional<string> time = _outFile.getAtt<string>(_data.vrad.datasets[0] + "/what", "starttime");
+      if(date && time)
+         start = HoofAux::toTime(date.value() + time.value());
+   }
+   const Profile* prior = _previousProfile(start);
+   int nsectors = _data.zIdxs.size();
+   Profile profile = {start.value_or(0), _data.height, HoofSettings::zSectorSize,
+      vector<double>(nsectors, dNaN), vector<double>(nsectors, dNaN)};
+   int nFitted = 0;
+   int nTaken = 0;
+   int nSampled = 0;
+   int nRefitted = 0;
+   double residuals = 0.0;
 
    // loop on height sectors
    for(int z=0; z<_data.zIdxs.size(); z++)
    {
-      vector<Triple> idxs = _data.zIdxs[z];
+      const vector<Triple>& idxs = _data.zIdxs[z];
       int nidxs = idxs.size();
+      double u = dNaN;
+      double v = dNaN;
 
-      // only calculate wind model if we have enough points in the height level
-      if(nidxs >= HoofSettings::minGoodPoints)
+      // with a previous model of the sector, fit with it as a prior or take it if there are too few points
+      if(prior != nullptr && z < prior->us.size() && !isnan(prior->us[z]))
       {
-         // get the A, B and D for current height level
-         double As[nidxs];
-         double Bs[nidxs];
-         double Ds[nidxs];
-         HoofAux::subset(_As, idxs, As, nidxs);
-         HoofAux::subset(_Bs, idxs, Bs, nidxs);
-         HoofAux::subset(_Ds, idxs, Ds, nidxs);
-
-         // use gsl_multifit to fit the curve to A,B and D and get u and v of the wind model
-         gsl_matrix *X = gsl_matrix_alloc(nidxs, 2);
-         gsl_vector *y = gsl_vector_alloc(nidxs);
-         gsl_vector *c = gsl_vector_alloc(2);
-         gsl_matrix *cov = gsl_matrix_alloc(2, 2);
-         for(int j=0; j<nidxs; j++)
+         int sample = HoofSettings::warmStartSample;
+         if(nidxs >= HoofSettings::warmStartMinPoints)
          {
-            gsl_matrix_set(X, j, 0, -As[j]);
-            gsl_matrix_set(X, j, 1, Bs[j]);
-            gsl_vector_set(y, j, Ds[j]);
+            if(sample > 0 && nidxs > sample)
+               _fitWithPrior(_sample(idxs, sample), prior->us[z], prior->vs[z], u, v);
+            else
+               _fitWithPrior(idxs, prior->us[z], prior->vs[z], u, v);
+            profile.us[z] = u;
+            profile.vs[z] = v;
+            nFitted++;
          }
-         double chisq;
-         gsl_multifit_linear_workspace *work = gsl_multifit_linear_alloc(nidxs, 2);
-         gsl_multifit_linear(X, y, c, cov, &chisq, work);
-         double u = gsl_vector_get(c, 0);
-         double v = gsl_vector_get(c, 1);
-
-         for(int i=0; i<nidxs; i++)         
+         else
          {
-            int iel = idxs[i][0];
-            int iaz = idxs[i][1];
-            double vm = _cosEls[iel] * (u * _sinAzs[iel][iaz] + v * _cosAzs[iel][iaz]);
-            if(abs(vm) < vmax)
-               _data.wModels[iel][iaz][idxs[i][2]] = vm;
+            u = prior->us[z];
+            v = prior->vs[z];
+            nTaken++;
          }
       }
+      // only calculate wind model if we have enough points in the height level
+      else if(nidxs >= HoofSettings::minGoodPoints)
+      {
+         // fit a sample of the good points first, and all of them if the sample leaves a high residual
+         int sample = HoofSettings::fitSample;
+         if(sample > 0 && nidxs > sample)
+         {
+            double residual = _fit(_sample(idxs, sample), u, v);
+            residuals += residual;
+            nSampled++;
+            if(residual > HoofSettings::maxFitResidual)
+            {
+               _fit(idxs, u, v);
+               nRefitted++;
+            }
+         }
+         else
+            _fit(idxs, u, v);
+         profile.us[z] = u;
+         profile.vs[z] = v;
+      }
+      else
+         continue;
+
+      for(int i=0; i<nidxs; i++)         
+      {
+         int iel = idxs[i][0];
+         int iaz = idxs[i][1];
+         T vm = _cosEls[iel] * ((T)u * _sinAzs[iel][iaz] + (T)v * _cosAzs[iel][iaz]);
+         if(abs(vm) < vmax)
+            _wModels[iel][iaz][idxs[i][2]] = vm;
+      }
    }
+
+   if(nSampled > 0)
+      cout << "Fitted " << nSampled << " sectors on " << HoofSettings::fitSample << " points, mean residual " <<
+         residuals/nSampled << " m/s, " << nRefitted << " sectors refitted on all points" << endl;
+
+   // keep this volume's fits for the next volume of the site
+   if(prior != nullptr)
+      cout << "Warm start from the previous volume: " << nFitted << " sectors fitted with it, " << nTaken <<
+         " sectors took its model" << endl;
+   if(start)
+      _profiles[_data.site] = profile;
 }
 
 /**
    @brief Dealiases.
 */
-void HoofDealiaser::dealias()
+template<typename T>
+void HoofDealiaser<T>::dealias()
 {
    // prepare variables
    int nel = _data.vrad.nel;
@@ -225,8 +414,8 @@ void HoofDealiaser::dealias()
    int nr = _data.vrad.nrMax;
    double nymax = (int)(HoofSettings::maxWind/_vnyMin);
    _data.dvrads = vector3D<double>(nel, vector2D<double>(naz, vector<double>(nr, dNaN)));
-   double inf = std::numeric_limits<double>::infinity();
-   vector3D<double> mns = vector3D<double>(nel, vector2D<double>(naz, vector<double>(nr, inf)));
+   T inf = std::numeric_limits<T>::infinity();
+   vector3D<T> mns = vector3D<T>(nel, vector2D<T>(naz, vector<T>(nr, inf)));
    vector3D<int> ns = vector3D<int>(nel, vector2D<int>(naz, vector<int>(nr, iNaN)));
 
    // get Nyquist multipliers
@@ -234,16 +423,16 @@ void HoofDealiaser::dealias()
    {
       for(int i=0; i<nel; i++)
       {
-         double vny = _data.vrad.vnys[i];
+         T vny = _data.vrad.vnys[i];
          for(int j=0; j<_data.vrad.naz[i]; j++)
          {
             for(int k=0; k<_data.vrad.nr[i]; k++)
             {
-               double wm = _data.wModels[i][j][k];
-               double m = _data.vrad.meas[i][j][k];
+               T wm = _wModels[i][j][k];
+               T m = _meas[i][j][k];
                if(!(isnan(wm) || isnan(m)))
                {
-                  double currMn = abs(m + 2.0*vny*(double)n - wm);
+                  T currMn = abs(m + (T)2.0*vny*(T)n - wm);
                   if(currMn < mns[i][j][k])
                   {
                      mns[i][j][k] = currMn;
@@ -258,15 +447,15 @@ void HoofDealiaser::dealias()
    // dealias VRAD
    for(int i=0; i<nel; i++)
    {
-      double vny = _data.vrad.vnys[i];
+      T vny = _data.vrad.vnys[i];
       for(int j=0; j<_data.vrad.naz[i]; j++)
       {
          for(int k=0; k<_data.vrad.nr[i]; k++)
          {
-            double m = _data.vrad.meas[i][j][k];
+            T m = _meas[i][j][k];
             int n = ns[i][j][k];
             if(!(isnan(m) || isnan(n) || isnan(_Ds[i][j][k])))
-               _data.dvrads[i][j][k] = m + 2.0*(double)n*vny;
+               _data.dvrads[i][j][k] = m + (T)2.0*(T)n*vny;
          }
       }         
    }
@@ -275,7 +464,8 @@ void HoofDealiaser::dealias()
 /**
    @brief Writes dealiased data to the VRAD data group.
 */
-void HoofDealiaser::write()
+template<typename T>
+void HoofDealiaser<T>::write()
 {
    for(int i=0; i<_data.vrad.datasets.size(); i++)
    {
@@ -329,4 +519,8 @@ void HoofDealiaser::write()
       _outFile.writeAtt<string>(dataset + "/quality1/how", "task", "dealiasing");
       _outFile.writeDataset(dataset + "/quality1", "data", qual);
    }
-}
\ No newline at end of file
+}
+
+// --- instantiate for the [Precision] settings
+template class HoofDealiaser<float>;
+template class HoofDealiaser<double>;
@@ -9,6 +9,8 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <ctime>
 #include <optional>
 #include <HoofTypes.h>
 #include <HoofWorker.h>
@@ -18,21 +20,54 @@
 /**
    @class HoofDealiaser
    @brief Worker object that dealiases VRAD measurements.
+
+   With [Warm start dealiasing], the wind profile of each volume is kept per site for the next volume of
+   the site. The profiles are kept in the process, so each worker process keeps its own.
+
+   The torus mapping, wind models and Nyquist multiplier search are calculated in T, float or double as
+   chosen with [Precision]. The homogenized data are read from and the dealiased data stored to HoofData
+   in double.
 */
+template<typename T>
 class HoofDealiaser : public HoofWorker
 {
    private:
       // members
       HoofData& _data;                  ///< Object holding data used in dealiasing.
       HoofH5File& _outFile;             ///< Output file to write the dealiased data to.
-      hoof::vector3D<double> _As;       ///< A coefficients of the torus mapping (el, az, r).
-      hoof::vector3D<double> _Bs;       ///< B coefficients of the torus mapping (el, az, r).
-      hoof::vector3D<double> _Ds;       ///< D coefficients of the torus mapping (el, az, r).
-      std::vector<double> _cosEls;      ///< Cosines of elevation angles for faster calculation (el).
-      hoof::vector2D<double> _cosAzs;   ///< Cosines of azimuth angles for faster calculation (el, az).
-      hoof::vector2D<double> _sinAzs;   ///< Sines of azimuth angles for faster calculation (el, az).
+      hoof::vector3D<T> _meas;          ///< VRAD measurements (el, az, r).
+      hoof::vector3D<T> _As;            ///< A coefficients of the torus mapping (el, az, r).
+      hoof::vector3D<T> _Bs;            ///< B coefficients of the torus mapping (el, az, r).
+      hoof::vector3D<T> _Ds;            ///< D coefficients of the torus mapping (el, az, r).
+      hoof::vector3D<T> _wModels;       ///< Values of the wind model (el, az, r).
+      std::vector<T> _cosEls;           ///< Cosines of elevation angles for faster calculation (el).
+      hoof::vector2D<T> _cosAzs;        ///< Cosines of azimuth angles for faster calculation (el, az).
+      hoof::vector2D<T> _sinAzs;        ///< Sines of azimuth angles for faster calculation (el, az).
       double _vnyMin;                   ///< Smallest Nyquist velocity in the file.
 
+      /**
+         @struct Profile
+         @brief Holds the wind profile of a volume, fitted u and v for each height sector.
+      */
+      struct Profile
+      {
+         std::time_t start;             ///< Start time of the first VRAD sweep of the volume.
+         double zStart;                 ///< Start height of the first height sector.
+         double dz;                     ///< Height sector size.
+         std::vector<double> us;        ///< Fitted u for all sectors, NaN where no model was fitted.
+         std::vector<double> vs;        ///< Fitted v for all sectors, NaN where no model was fitted.
+      };
+      static std::map<std::string, Profile> _profiles;   ///< Wind profile of the previous volume, by site.
+
+      // gets the wind profile of the previous volume of the site if it can be used for this volume
+      const Profile* _previousProfile(std::optional<std::time_t> start) const;
+      // takes an evenly spaced sample of the good points of a height sector
+      std::vector<hoof::Triple> _sample(const std::vector<hoof::Triple>& idxs, int n) const;
+      // fits the wind model of a height sector and returns the RMS residual
+      double _fit(const std::vector<hoof::Triple>& idxs, double& u, double& v) const;
+      // fits the wind model of a height sector with the wind of the previous profile as a prior
+      void _fitWithPrior(const std::vector<hoof::Triple>& idxs, double u0, double v0, double& u, double& v) const;
+
    public:
       // constructor
       HoofDealiaser(HoofData& data, HoofH5File& outFile);
@@ -7,36 +7,174 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <variant>
 #include <type_traits>
 #include <cstring>
+#include <map>
+#include <chrono>
+#include <iostream>
+#include <cstdio>
+#include <stdexcept>
+#include <filesystem>
+#include <unistd.h>
+#include <fcntl.h>
 #include <H5Cpp.h>
 #include <HoofTypes.h>
 #include <HoofAux.h>
+#include <HoofSettings.h>
+#include <HoofTrace.h>
 #include <HoofH5File.h>
 
 using std::string;
 using std::vector;
 using std::optional;
 using std::is_same_v;
+using std::map;
+using std::cout;
+using std::endl;
+using std::filesystem::path;
 using namespace H5;
 using namespace hoof;
 
+// --- initialize static members
+thread_local string HoofH5File::_stage = "";
+thread_local vector<std::pair<string, map<string, HoofH5File::Account>>> HoofH5File::_accounts;
+
+/**
+   @brief Runs one HDF5 operation and, with HDF5 accounting enabled, adds its time and bytes to the
+      account of the stage of the calling thread.
+   @param operation Name of the operation.
+   @param bytes Bytes read or written by the operation.
+   @param call The operation.
+   @return The result of the operation.
+*/
+template<typename F> auto HoofH5File::_timed(const char* operation, hsize_t bytes, F call)
+{
+   if(!HoofSettings::hdf5Accounting)
+      return call();
+   Time begin = Clock::now();
+   auto account = [&]()
+   {
+      if(_accounts.empty() || _accounts.back().first != _stage)
+         _accounts.push_back({_stage, {}});
+      Account& a = _accounts.back().second[operation];
+      a.calls++;
+      a.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+      a.bytes += bytes;
+   };
+   if constexpr(std::is_void_v<decltype(call())>)
+   {
+      call();
+      account();
+   }
+   else
+   {
+      auto result = call();
+      account();
+      return result;
+   }
+}
+
 /**
    @brief Default constructor.
 */
-HoofH5File::HoofH5File() {}
+HoofH5File::HoofH5File() : _deferred(false), _inMemory(false) {}
 
 /**
    @brief Constructor, opens a HDF5 file for reading or writing.
+
+   With "memory" the file is built in memory with the core driver and written to disk in one
+   sequential write when it is closed. Metadata and small raw data are aggregated into 64 KB blocks,
+   so they are not scattered between the datasets in many small pieces. With "image" the file is only
+   built in memory and never written to disk, its contents are taken with image(). With "swmr" a file
+   that another process is still writing in SWMR mode is opened for reading; datasets it appends to
+   show their current extent each time they are opened.
+
+   With [Atomic output], a file opened for writing is created under a hidden temporary name next to
+   filePath and renamed to filePath when it is closed.
+
    @param filePath Path of the file to open.
-   @param access "read" or "write".
+   @param access "read", "write", "memory", "image" or "swmr".
 */
-HoofH5File::HoofH5File(const string& filePath, const string& access)
+HoofH5File::HoofH5File(const string& filePath, const string& access) : _deferred(false), _inMemory(false)
 {
+   HoofTrace::Scope scope("Open file", "hdf5");
+   string createPath = filePath;
+   if((access == "write" || access == "memory") && HoofSettings::atomicOutput)
+   {
+      _path = filePath;
+      _tempPath = (path(filePath).parent_path() / ("." + path(filePath).filename().string() + ".part")).string();
+      createPath = _tempPath;
+   }
    if(access == "read")
-      _file = H5File(filePath, H5F_ACC_RDONLY);
+      _file = _timed("file open", 0, [&]() { return H5File(filePath, H5F_ACC_RDONLY); });
+   if(access == "swmr")
+      _file = _timed("file open", 0, [&]() { return H5File(filePath, H5F_ACC_RDONLY | H5F_ACC_SWMR_READ); });
    if(access == "write")
-      _file = H5File(filePath, H5F_ACC_TRUNC);
+      _file = _timed("file create", 0, [&]() { return H5File(createPath, H5F_ACC_TRUNC); });
+   if(access == "memory")
+   {
+      FileAccPropList fileAccess;
+      H5Pset_fapl_core(fileAccess.getId(), 4 << 20, true);
+      H5Pset_meta_block_size(fileAccess.getId(), 1 << 16);
+      H5Pset_small_data_block_size(fileAccess.getId(), 1 << 16);
+      _file = _timed("file create", 0, [&]()
+         { return H5File(createPath, H5F_ACC_TRUNC, FileCreatPropList::DEFAULT, fileAccess); });
+      fileAccess.close();
+      _inMemory = true;
+   }
+   if(access == "image")
+   {
+      FileAccPropList fileAccess;
+      H5Pset_fapl_core(fileAccess.getId(), 4 << 20, false);
+      _file = _timed("file create", 0, [&]()
+         { return H5File(filePath, H5F_ACC_TRUNC, FileCreatPropList::DEFAULT, fileAccess); });
+      fileAccess.close();
+      _inMemory = true;
+   }
+}
+
+/**
+   @brief Constructor, opens a HDF5 file image in memory for reading with the core driver. HDF5 keeps
+      its own copy of the image, so the image can be freed after the file is opened.
+   @param image The contents of a HDF5 file.
+   @param name Name of the file, used only in HDF5 error messages.
+*/
+HoofH5File::HoofH5File(const vector<char>& image, const string& name) : _deferred(false), _inMemory(false)
+{
+   HoofTrace::Scope scope("Open file image", "hdf5");
+   FileAccPropList access;
+   H5Pset_fapl_core(access.getId(), 1 << 20, false);
+   H5Pset_file_image(access.getId(), (void*)image.data(), image.size());
+   _file = _timed("file open", image.size(), [&]()
+      { return H5File(name, H5F_ACC_RDONLY, FileCreatPropList::DEFAULT, access); });
+   access.close();
+}
+
+/**
+   @brief Checks if a file is open for writing in SWMR mode by another process. Such a file cannot be
+      opened for plain reading, but can be opened for SWMR reading.
+   @param filePath Path of the file.
+   @return True if the file is being written in SWMR mode, false otherwise.
+*/
+bool HoofH5File::writing(const string& filePath)
+{
+   hid_t id = H5I_INVALID_HID;
+   H5E_BEGIN_TRY
+   {
+      id = H5Fopen(filePath.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+      if(id >= 0)
+      {
+         H5Fclose(id);
+         return false;
+      }
+      id = H5Fopen(filePath.c_str(), H5F_ACC_RDONLY | H5F_ACC_SWMR_READ, H5P_DEFAULT);
+   }
+   H5E_END_TRY;
+   if(id < 0)
+      return false;
+   H5Fclose(id);
+   return true;
 }
 
 /**
@@ -46,9 +184,10 @@ HoofH5File::HoofH5File(const string& filePath, const string& access)
 vector<string> HoofH5File::getDatasets() const
 {
    vector<string> datasets;
-   for(hsize_t i=0; i<_file.getNumObjs(); i++)
+   hsize_t nObjs = _timed("object list", 0, [&]() { return _file.getNumObjs(); });
+   for(hsize_t i=0; i<nObjs; i++)
    {
-      string name = _file.getObjnameByIdx(i);
+      string name = _timed("object list", 0, [&]() { return _file.getObjnameByIdx(i); });
       if(name.find("dataset") != string::npos)
          datasets.push_back(name);
    }
@@ -64,10 +203,11 @@ vector<string> HoofH5File::getDatasets() const
 vector<string> HoofH5File::getDatas(const string& dataset, const string& groupType) const
 {
    vector<string> datas;
-   Group datasetGroup = _file.openGroup(dataset);
-   for(int i=0; i<datasetGroup.getNumObjs(); i++)
+   Group datasetGroup = _timed("group open", 0, [&]() { return _file.openGroup(dataset); });
+   hsize_t nObjs = _timed("object list", 0, [&]() { return datasetGroup.getNumObjs(); });
+   for(int i=0; i<nObjs; i++)
    {
-      string name = datasetGroup.getObjnameByIdx(i);
+      string name = _timed("object list", 0, [&]() { return datasetGroup.getObjnameByIdx(i); });
       if(name.find(groupType) != string::npos)
          datas.push_back(name);      
    }
@@ -84,30 +224,39 @@ vector<string> HoofH5File::getDatas(const string& dataset, const string& groupTy
 template<typename T> optional<T> HoofH5File::getAtt(const string& group, const string& name) const
 {
    optional<T> value = std::nullopt;
-   if(_file.exists(group))
+   if(_timed("link check", 0, [&]() { return _file.exists(group); }))
    {
-      Group g = _file.openGroup(group);
-      htri_t attStatus = H5Aexists(g.getId(), name.c_str());
+      Group g = _timed("group open", 0, [&]() { return _file.openGroup(group); });
+      htri_t attStatus = _timed("attribute check", 0, [&]() { return H5Aexists(g.getId(), name.c_str()); });
       if(attStatus > 0)
       {
-         Attribute att = g.openAttribute(name);
+         Attribute att = _timed("attribute open", 0, [&]() { return g.openAttribute(name); });
 
          // handle string attributes
          if constexpr (is_same_v<T, string>)
          {
             StrType strType = att.getStrType();
-            size_t len = strType.getSize();
-            char val[len+1];
-            val[len] = '\0';
-            att.read(strType, val);
-            value = string(val);
+            if(strType.isVariableStr())
+            {
+               // string attributes written by HOOF have variable length
+               string val;
+               _timed("attribute read", 0, [&]() { att.read(strType, val); });
+               value = val;
+            }
+            else
+            {
+               size_t len = strType.getSize();
+               vector<char> val(len+1, '\0');
+               _timed("attribute read", len, [&]() { att.read(strType, val.data()); });
+               value = string(val.data());
+            }
             strType.close();
          }
          // handle double and int attributes
          else
          {
             T val;
-            att.read(HDF5Type<T>::type(), &val);
+            _timed("attribute read", sizeof(T), [&]() { att.read(HDF5Type<T>::type(), &val); });
             value = val;
          }
          att.close();
@@ -130,20 +279,27 @@ template optional<int> HoofH5File::getAtt<int>(const string& group, const string
 template<typename T> void HoofH5File::writeAtt(const string& group, const string& name,
    const T& value) const
 {
+   // only record the write if writes are deferred
+   if(_deferred)
+   {
+      _pending.push_back({false, group, name, value, 0, 0, {}});
+      return;
+   }
+
    // split groups into subgroups and create the hierarchy if it does not exist
    vector<string> groups = HoofAux::split(group, "/", " ");
-   Group currGroup = _file.openGroup("/");
+   Group currGroup = _timed("group open", 0, [&]() { return _file.openGroup("/"); });
    for(int i=0; i<groups.size(); i++)
    {      
-      if(!currGroup.exists(groups[i]))
-         currGroup = currGroup.createGroup(groups[i]);
+      if(!_timed("link check", 0, [&]() { return currGroup.exists(groups[i]); }))
+         currGroup = _timed("group create", 0, [&]() { return currGroup.createGroup(groups[i]); });
       else
-         currGroup = currGroup.openGroup(groups[i]);
+         currGroup = _timed("group open", 0, [&]() { return currGroup.openGroup(groups[i]); });
    }
    currGroup.close();
    
    // if attribute exists, overwrite its value, otherwise create it
-   Group g = _file.openGroup(group);
+   Group g = _timed("group open", 0, [&]() { return _file.openGroup(group); });
    DataSpace attSpace(H5S_SCALAR);
    DataType attType;
    if constexpr(is_same_v<T,string>)
@@ -151,11 +307,36 @@ template<typename T> void HoofH5File::writeAtt(const string& group, const string
    else
       attType = HDF5Type<T>::type();
    Attribute att;
-   if(H5Aexists(g.getId(), name.c_str()))
-      att = g.openAttribute(name);
+   if(_timed("attribute check", 0, [&]() { return H5Aexists(g.getId(), name.c_str()); }))
+   {
+      att = _timed("attribute open", 0, [&]() { return g.openAttribute(name); });
+
+      // a string attribute of fixed length, as copied from an input file, is replaced by one of the new length
+      if constexpr(is_same_v<T,string>)
+      {
+         if(!att.getStrType().isVariableStr())
+         {
+            att.close();
+            _timed("attribute delete", 0, [&]() { g.removeAttr(name); });
+            attType = H5::StrType(H5::PredType::C_S1, value.size() + 1);
+            att = _timed("attribute create", 0, [&]() { return g.createAttribute(name, attType, attSpace); });
+            _timed("attribute write", value.size(), [&]() { att.write(attType, value.c_str()); });
+            att.close();
+            attType.close();
+            attSpace.close();
+            g.close();
+            return;
+         }
+      }
+   }
    else
-      att = g.createAttribute(name, attType, attSpace);
-   att.write(attType, &value);
+      att = _timed("attribute create", 0, [&]() { return g.createAttribute(name, attType, attSpace); });
+   hsize_t size = 0;
+   if constexpr(is_same_v<T,string>)
+      size = value.size();
+   else
+      size = sizeof(T);
+   _timed("attribute write", size, [&]() { att.write(attType, &value); });
    att.close();
 
    // close to release memory
@@ -180,8 +361,84 @@ template void HoofH5File::writeAtt<int>(const string& group, const string& name,
 void HoofH5File::copyDataset(HoofH5File& outFile, const std::string& oldGroup,
    const std::string& newGroup) const
 {
-   H5Ocopy(_file.getId(), oldGroup.c_str(), outFile._file.getId(), newGroup.c_str(),
-      H5P_DEFAULT, H5P_DEFAULT);
+   HoofTrace::Scope scope("Copy dataset", "hdf5");
+   _timed("dataset copy", 0, [&]() { return H5Ocopy(_file.getId(), oldGroup.c_str(), outFile._file.getId(),
+      newGroup.c_str(), H5P_DEFAULT, H5P_DEFAULT); });
+}
+
+/**
+   @brief Copies the attributes of a group from this file to the same group in another file, which
+      has to exist there. Attributes are copied with their own types, so fixed length strings stay
+      fixed length.
+   @param outFile The file to copy to.
+   @param group The group.
+*/
+void HoofH5File::copyAttributes(HoofH5File& outFile, const string& group) const
+{
+   Group g = _timed("group open", 0, [&]() { return _file.openGroup(group); });
+   Group outGroup = _timed("group open", 0, [&]() { return outFile._file.openGroup(group); });
+   for(int i=0; i<g.getNumAttrs(); i++)
+   {
+      Attribute att = _timed("attribute open", 0, [&]() { return g.openAttribute(i); });
+      DataType type = att.getDataType();
+      DataSpace space = att.getSpace();
+      vector<char> value(att.getStorageSize());
+      _timed("attribute read", value.size(), [&]() { att.read(type, value.data()); });
+      if(H5Aexists(outGroup.getId(), att.getName().c_str()) > 0)
+         _timed("attribute delete", 0, [&]() { outGroup.removeAttr(att.getName()); });
+      Attribute outAtt = _timed("attribute create", 0, [&]()
+         { return outGroup.createAttribute(att.getName(), type, space); });
+      _timed("attribute write", value.size(), [&]() { outAtt.write(type, value.data()); });
+      outAtt.close();
+      space.close();
+      type.close();
+      att.close();
+   }
+   outGroup.close();
+   g.close();
+}
+
+/**
+   @brief Gets the current dimensions of a dataset. In a file opened with "swmr", the dataset is
+      refreshed first, so rows appended by the writer are counted.
+   @param group The dataset group.
+   @param name The dataset name.
+   @return The dimensions, or an empty vector if the dataset does not exist.
+*/
+vector<hsize_t> HoofH5File::getExtent(const string& group, const string& name) const
+{
+   vector<hsize_t> dims;
+   if(!_timed("link check", 0, [&]() { return _file.exists(group + "/" + name); }))
+      return dims;
+   DataSet dataset = _timed("dataset open", 0, [&]() { return _file.openDataSet(group + "/" + name); });
+   _timed("dataset refresh", 0, [&]() { return H5Drefresh(dataset.getId()); });
+   DataSpace space = dataset.getSpace();
+   dims.resize(space.getSimpleExtentNdims());
+   space.getSimpleExtentDims(dims.data());
+   space.close();
+   dataset.close();
+   return dims;
+}
+
+/**
+   @brief Checks if a dataset exists in the file or is recorded to be written.
+   @param group The dataset group.
+   @param name The dataset name.
+   @return True if the dataset exists or will be written, false otherwise.
+*/
+bool HoofH5File::hasDataset(const string& group, const string& name) const
+{
+   for(int i=0; i<_pending.size(); i++)
+   {
+      if(_pending[i].dataset && _pending[i].group == group && _pending[i].name == name)
+         return true;
+   }
+   if(!_timed("link check", 0, [&]() { return _file.exists(group); }))
+      return false;
+   Group g = _timed("group open", 0, [&]() { return _file.openGroup(group); });
+   bool found = _timed("link check", 0, [&]() { return H5Lexists(g.getId(), name.c_str(), H5P_DEFAULT); }) > 0;
+   g.close();
+   return found;
 }
 
 /**
@@ -192,21 +449,22 @@ void HoofH5File::copyDataset(HoofH5File& outFile, const std::string& oldGroup,
 */
 optional<vector2D<unsigned char>> HoofH5File::getDataset(const string& group, const string& name) const
 {
+   HoofTrace::Scope scope("Read dataset", "hdf5");
    optional<vector2D<unsigned char>> dataset = std::nullopt;
 
-   if(_file.exists(group))
+   if(_timed("link check", 0, [&]() { return _file.exists(group); }))
    {
-      Group g = _file.openGroup(group);
-      htri_t datasetStatus = H5Lexists(g.getId(), name.c_str(), H5P_DEFAULT);
+      Group g = _timed("group open", 0, [&]() { return _file.openGroup(group); });
+      htri_t datasetStatus = _timed("link check", 0, [&]() { return H5Lexists(g.getId(), name.c_str(), H5P_DEFAULT); });
       if(datasetStatus > 0)
       {
-         DataSet d = g.openDataSet(name);
+         DataSet d = _timed("dataset open", 0, [&]() { return g.openDataSet(name); });
          DataSpace space = d.getSpace();
          int nDims = space.getSimpleExtentNdims();
-         hsize_t dims[nDims];
-         space.getSimpleExtentDims(dims);
-         unsigned char val[dims[0]*dims[1]];
-         d.read(val, PredType::NATIVE_UINT8);
+         vector<hsize_t> dims(nDims);
+         space.getSimpleExtentDims(dims.data());
+         vector<unsigned char> val(dims[0]*dims[1]);
+         _timed("dataset read", val.size(), [&]() { d.read(val.data(), PredType::NATIVE_UINT8); });
          vector2D<unsigned char> values(dims[0], vector<unsigned char>(dims[1], 0));
          for(int i=0; i<dims[0]; i++)
          {
@@ -231,40 +489,227 @@ optional<vector2D<unsigned char>> HoofH5File::getDataset(const string& group, co
 */
 void HoofH5File::writeDataset(const string& group, const string& name, const vector2D<unsigned char>& data)
 {
-   Group g = _file.openGroup(group);
-
-   if(H5Lexists(g.getId(), name.c_str(), H5P_DEFAULT))
-      H5Ldelete(g.getId(), name.c_str(), H5P_DEFAULT);
-
    hsize_t rows = data.size();
    hsize_t cols = data[0].size();
-   hsize_t dims[2] = {rows, cols};
-   DataSpace space(2, dims);
    vector<unsigned char> data1D(rows*cols);
    for(int i=0; i<rows; i++)
    {
       for(int j=0; j<cols; j++)
          data1D[i*cols + j] = data[i][j];
    }
-   DataSet d = g.createDataSet(name, PredType::NATIVE_UINT8, space);
-   d.write(data1D.data(), PredType::NATIVE_UINT8);
+
+   // only record the write if writes are deferred
+   if(_deferred)
+   {
+      _pending.push_back({true, group, name, 0, rows, cols, std::move(data1D)});
+      return;
+   }
+   _writeDataset(group, name, rows, cols, data1D);
+}
+
+/**
+   @brief Creates or replaces a dataset from a contiguous buffer.
+   @param group The dataset group.
+   @param name The dataset name.
+   @param rows Number of rows.
+   @param cols Number of columns.
+   @param data1D The data array, row after row.
+*/
+void HoofH5File::_writeDataset(const string& group, const string& name, hsize_t rows, hsize_t cols,
+   const vector<unsigned char>& data1D)
+{
+   HoofTrace::Scope scope("Write dataset", "hdf5");
+   Group g = _timed("group open", 0, [&]() { return _file.openGroup(group); });
+
+   if(_timed("link check", 0, [&]() { return H5Lexists(g.getId(), name.c_str(), H5P_DEFAULT); }))
+      _timed("link delete", 0, [&]() { return H5Ldelete(g.getId(), name.c_str(), H5P_DEFAULT); });
+
+   hsize_t dims[2] = {rows, cols};
+   DataSpace space(2, dims);
+   DataSet d = _timed("dataset create", 0, [&]() { return g.createDataSet(name, PredType::NATIVE_UINT8, space); });
+   _timed("dataset write", data1D.size(), [&]() { d.write(data1D.data(), PredType::NATIVE_UINT8); });
    d.close();
    space.close();
    g.close();
 }
 
 /**
-   @brief Flushes the file buffer to file.
+   @brief Removes a group and everything in it from the file.
+   @param group The group to remove.
+*/
+void HoofH5File::removeGroup(const string& group)
+{
+   if(_timed("link check", 0, [&]() { return _file.exists(group); }))
+      _timed("link delete", 0, [&]() { return H5Ldelete(_file.getId(), group.c_str(), H5P_DEFAULT); });
+}
+
+/**
+   @brief Renames a group.
+   @param group The group.
+   @param newGroup New name of the group.
+*/
+void HoofH5File::moveGroup(const string& group, const string& newGroup)
+{
+   _timed("link move", 0, [&]()
+      { return H5Lmove(_file.getId(), group.c_str(), _file.getId(), newGroup.c_str(), H5P_DEFAULT, H5P_DEFAULT); });
+}
+
+/**
+   @brief Gets the contents of a file built in memory, as they would be written to disk.
+   @return The file image.
+*/
+vector<char> HoofH5File::image() const
+{
+   _timed("file flush", 0, [&]() { _file.flush(H5F_scope_t::H5F_SCOPE_GLOBAL); });
+   ssize_t size = H5Fget_file_image(_file.getId(), nullptr, 0);
+   if(size < 0)
+      throw std::runtime_error("Could not get the image of " + _file.getFileName());
+   vector<char> image(size);
+   _timed("file image", size, [&]() { return H5Fget_file_image(_file.getId(), image.data(), size); });
+   return image;
+}
+
+/**
+   @brief Starts recording attribute and dataset writes instead of executing them. Reads still see
+      the file without the recorded writes.
+*/
+void HoofH5File::defer()
+{
+   _deferred = true;
+}
+
+/**
+   @brief Executes the recorded writes in the order they were made and stops recording.
+*/
+void HoofH5File::commit()
+{
+   _deferred = false;
+   for(int i=0; i<_pending.size(); i++)
+   {
+      PendingWrite& w = _pending[i];
+      if(w.dataset)
+         _writeDataset(w.group, w.name, w.rows, w.cols, w.data);
+      else
+         std::visit([&](const auto& value) { writeAtt(w.group, w.name, value); }, w.value);
+   }
+   _pending.clear();
+}
+
+/**
+   @brief Flushes the file buffer to file. A file built in memory is only written at close, since
+      flushing it would write the whole file.
 */
 void HoofH5File::flush()
 {
-   _file.flush(H5F_scope_t::H5F_SCOPE_GLOBAL);
+   if(_inMemory)
+      return;
+   _timed("file flush", 0, [&]() { _file.flush(H5F_scope_t::H5F_SCOPE_GLOBAL); });
 }
 
 /**
-   @brief Closes the H5File to free memory.
+   @brief Flushes a file or directory to disk.
+   @param filePath Path of the file or directory.
+*/
+static void syncToDisk(const string& filePath)
+{
+   int fd = open(filePath.c_str(), O_RDONLY);
+   if(fd < 0)
+      return;
+   fsync(fd);
+   ::close(fd);
+}
+
+/**
+   @brief Renames a closed output file from its temporary name to its name, after flushing it to disk
+      with [Fsync output], and creates its .done marker with [Done markers].
+*/
+void HoofH5File::_publish()
+{
+   string tempPath = _tempPath;
+   _tempPath = "";
+   if(HoofSettings::fsyncOutput)
+      syncToDisk(tempPath);
+   if(std::rename(tempPath.c_str(), _path.c_str()) != 0)
+      throw std::runtime_error("Could not rename " + tempPath + " to " + _path);
+   if(HoofSettings::doneMarkers)
+   {
+      int fd = open((_path + ".done").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if(fd >= 0)
+         ::close(fd);
+   }
+   if(HoofSettings::fsyncOutput)
+      syncToDisk(path(_path).parent_path().string());
+}
+
+/**
+   @brief Closes the H5File to free memory. An output file written under a temporary name is renamed
+      into place.
 */
 void HoofH5File::close()
+{
+   HoofTrace::Scope scope("Close file", "hdf5");
+   _timed("file close", 0, [&]() { _file.close(); });
+   if(!_tempPath.empty())
+      _publish();
+}
+
+/**
+   @brief Closes an output file of a file that failed. With [Atomic output] its temporary file is removed,
+      so no partial output is put into place, otherwise the file is closed as it is.
+*/
+void HoofH5File::discard()
+{
+   try
+   {
+      _timed("file close", 0, [&]() { _file.close(); });
+   }
+   catch(...)
+   {
+   }
+   if(!_tempPath.empty())
+      std::remove(_tempPath.c_str());
+   _tempPath = "";
+}
+
+/**
+   @brief Drops this handle of a file that a copy of it closes, e.g. in the I/O thread, so the file is
+      really closed and published by the copy.
+*/
+void HoofH5File::detach()
 {
    _file.close();
-}
\ No newline at end of file
+   _tempPath = "";
+}
+/**
+   @brief Sets the stage of the calling thread that its HDF5 operations are accounted to.
+   @param stage Name of the stage.
+*/
+void HoofH5File::setStage(const string& stage)
+{
+   _stage = stage;
+}
+
+/**
+   @brief Prints the number, time and bytes of the HDF5 operations of the calling thread per stage, in
+      the order the stages ran, and resets them, if HDF5 accounting is enabled.
+*/
+void HoofH5File::printAccounts()
+{
+   if(!HoofSettings::hdf5Accounting)
+      return;
+   cout << "HDF5 operations:" << endl;
+   for(auto& [stage, operations] : _accounts)
+   {
+      cout << "   " << stage << ":" << endl;
+      for(auto& [operation, a] : operations)
+      {
+         char line[128];
+         snprintf(line, sizeof(line), "      %-20s%8lld calls%10.2f ms", operation.c_str(), a.calls, a.ns / 1e6);
+         cout << line;
+         if(a.bytes > 0)
+            cout << "   " << a.bytes << " bytes";
+         cout << endl;
+      }
+   }
+   _accounts.clear();
+}
@@ -10,6 +10,8 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <variant>
+#include <map>
 #include <H5Cpp.h>
 #include <HoofTypes.h>
 
@@ -35,18 +37,71 @@ template<> struct HDF5Type<double>
 /**
    @class HoofH5File
    @brief Class that wraps the HDF5 API that is needed in HOOF.
+
+   After defer() is called, attribute and dataset writes are only recorded, with datasets already
+   converted to the contiguous buffers that HDF5 writes, and commit() executes them later, possibly
+   in another thread.
+
+   With [Atomic output], an output file is written under a hidden temporary name in the output folder and
+   renamed to its name only when it is closed, so programs that watch the output folder never see a
+   partly written file.
 */
 class HoofH5File
 {
    private:
+      /**
+         @struct PendingWrite
+         @brief Holds one recorded attribute or dataset write.
+      */
+      struct PendingWrite
+      {
+         bool dataset;                                    ///< True for a dataset, false for an attribute.
+         std::string group;                               ///< Group to write to.
+         std::string name;                                ///< Attribute or dataset name.
+         std::variant<std::string, double, int> value;    ///< Attribute value.
+         hsize_t rows;                                    ///< Number of dataset rows.
+         hsize_t cols;                                    ///< Number of dataset columns.
+         std::vector<unsigned char> data;                 ///< Dataset values, row after row.
+      };
+
       // members
-      H5::H5File _file;   ///< The opened HDF5 file.
+      H5::H5File _file;                              ///< The opened HDF5 file.
+      bool _deferred;                                ///< Flag for recording writes instead of executing them.
+      bool _inMemory;                                ///< Flag for a file built in memory and written to disk at close.
+      std::string _path;                             ///< Final path of an output file written under a temporary name.
+      std::string _tempPath;                         ///< Temporary path of the output file until it is published.
+      mutable std::vector<PendingWrite> _pending;    ///< Recorded writes.
+
+      /**
+         @struct Account
+         @brief Holds the number, time and bytes of one kind of HDF5 operation.
+      */
+      struct Account
+      {
+         long long calls;    ///< Number of calls.
+         long long ns;       ///< Time spent in the calls in nanoseconds.
+         long long bytes;    ///< Bytes read or written.
+      };
+      static thread_local std::string _stage;                                        ///< Stage of the calling thread.
+      static thread_local std::vector<std::pair<std::string, std::map<std::string, Account>>> _accounts;  ///< Accounts per stage, in order, and operation.
+
+      // runs and accounts one HDF5 operation
+      template<typename F> static auto _timed(const char* operation, hsize_t bytes, F call);
+      // creates or replaces a dataset from a contiguous buffer
+      void _writeDataset(const std::string& group, const std::string& name, hsize_t rows, hsize_t cols,
+         const std::vector<unsigned char>& data);
+      // renames a closed output file from its temporary name into place
+      void _publish();
 
    public:
       // default constructor
       HoofH5File();
       // constructor
       HoofH5File(const std::string& filePath, const std::string& access);
+      // constructor, opens a file image in memory for reading
+      HoofH5File(const std::vector<char>& image, const std::string& name);
+      // checks if a file is open for writing in SWMR mode by another process
+      static bool writing(const std::string& filePath);
       // gets all dataset names in the file
       std::vector<std::string> getDatasets() const;
       // gets all data or quality groups in a dataset
@@ -58,16 +113,40 @@ class HoofH5File
          const T& value) const;
       // copy a dataset from this file to another file
       void copyDataset(HoofH5File& outFile, const std::string& oldGroup, const std::string& newGroup) const;
+      // copy the attributes of a group from this file to the same group in another file
+      void copyAttributes(HoofH5File& outFile, const std::string& group) const;
+      // gets the current dimensions of a dataset
+      std::vector<hsize_t> getExtent(const std::string& group, const std::string& name) const;
+      // checks if a dataset exists or is about to be written
+      bool hasDataset(const std::string& group, const std::string& name) const;
       // gets a dataset
       std::optional<hoof::vector2D<unsigned char>> getDataset(const std::string& group,
          const std::string& name) const;
       // creates or replaces a dataset
       void writeDataset(const std::string& group, const std::string& name,
          const hoof::vector2D<unsigned char>& data);
+      // records writes from now on instead of executing them
+      void defer();
+      // executes the recorded writes
+      void commit();
+      // removes a group and everything in it
+      void removeGroup(const std::string& group);
+      // renames a group
+      void moveGroup(const std::string& group, const std::string& newGroup);
+      // gets the contents of a file built in memory
+      std::vector<char> image() const;
       // flushes the file buffer to file
       void flush();
-      // closes the H5File object to free memory
+      // closes the H5File object to free memory, an output file is renamed into place
       void close();
+      // closes an output file that failed without putting it into place
+      void discard();
+      // drops this handle of a file that a copy of it closes
+      void detach();
+      // sets the stage of the calling thread that HDF5 operations are accounted to
+      static void setStage(const std::string& stage);
+      // prints the HDF5 operations of the calling thread per stage and resets them
+      static void printAccounts();
 };
 
 #endif // HOOFH5FILE_GUARD
\ No newline at end of file
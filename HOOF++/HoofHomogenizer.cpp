@@ -185,7 +185,7 @@ template<typename T> optional<T> HoofHomogenizer::_getAtt(const string& group, c
       return comValue;
    
    // if nothing is found, add an error and return std::nullopt
-   error("attribute " + group + "/" + name + " not found");
+   error("MISSING_ATTRIBUTE", "attribute " + group + "/" + name + " not found");
    return std::nullopt;
 }
 
@@ -200,7 +200,7 @@ template<typename T> optional<T> HoofHomogenizer::_getHomAtt(const string& group
 {
    optional<T> fileAttValue = _outFile.getAtt<T>(group, name);
    if(!fileAttValue)
-      error("attribute " + group + "/" + name + " not found in the homogenized file");
+      error("MISSING_HOMOGENIZED_ATTRIBUTE", "attribute " + group + "/" + name + " not found in the homogenized file");
    return fileAttValue;
 }
 
@@ -275,7 +275,7 @@ optional<string> HoofHomogenizer::_getHoofTaskName(const string& quality)
 void HoofHomogenizer::_fillHomDataDataset(vector2D<double>& vec, const string& group, const string& name)
 {
    // get the dataset from the file
-   optional<vector2D<unsigned char>> dataset = _outFile.getDataset(group, name);
+   optional<vector2D<unsigned char>> dataset = _getHomDataset(group, name);
    if(dataset)
    {
       vector<vector<unsigned char>> d = dataset.value();
@@ -318,7 +318,7 @@ void HoofHomogenizer::_fillHomQualDataset(vector2D<double>& vec, const string& g
    double nodata)
 {
    // get the dataset from the file
-   optional<vector2D<unsigned char>> dataset = _outFile.getDataset(group, name);
+   optional<vector2D<unsigned char>> dataset = _getHomDataset(group, name);
    if(dataset)
    {
       // get the needed metadata from the same group to recalculate dataset to double values
@@ -446,7 +446,7 @@ void HoofHomogenizer::_getQtys(vector<HoofHomQty>& dbzs, vector<HoofHomQty>& ths
       optional<string> startDatetime = _getStartDatetime(dataset);
       if(!elAngle || !startDatetime)
       {
-         warning("no date or elevation angle in dataset " + dataset + ", skipping it");
+         warning("NO_DATE_OR_ELANGLE", "no date or elevation angle in dataset " + dataset + ", skipping it");
          continue;
       }
 
@@ -513,7 +513,7 @@ void HoofHomogenizer::_sortThs(const vector<HoofHomQty>& ths, const vector<HoofH
          }
          else if(d.size() > 1)
          {
-            warning("More than one DBZ quantity matches the TH quantity in " + th.oldDataset + "/" +
+            warning("AMBIGUOUS_TH_MATCH", "More than one DBZ quantity matches the TH quantity in " + th.oldDataset + "/" +
                th.oldData);
             for(int j=0; j<d.size(); j++)
             {
@@ -529,7 +529,7 @@ void HoofHomogenizer::_sortThs(const vector<HoofHomQty>& ths, const vector<HoofH
          }
       }
       if(!thFound)
-         warning("TH quantity in " + th.oldDataset + "/" + th.oldData +
+         warning("UNMATCHED_TH", "TH quantity in " + th.oldDataset + "/" + th.oldData +
             " has no matching DBZ group, omitting it");
    }
 }
@@ -565,13 +565,13 @@ void HoofHomogenizer::_checkDbzs(const vector<HoofHomQty>& dbzs, const vector<Ho
             }
             else
             {
-               warning("DBZ quantity in " + dbz.oldDataset + "/" + dbz.oldData +
+               warning("TH_DIMENSION_MISMATCH", "DBZ quantity in " + dbz.oldDataset + "/" + dbz.oldData +
                   " has a matching TH quantity, but dimensions are not the same, omitting both");               
             }
          }
       }
       else
-         warning("DBZ quantity in " + dbz.oldDataset + "/" + dbz.oldData +
+         warning("UNMATCHED_DBZ", "DBZ quantity in " + dbz.oldDataset + "/" + dbz.oldData +
                  " has no corresponding TH group, omitting it");
    }
 } 
@@ -611,7 +611,7 @@ void HoofHomogenizer::_sortQuals(const vector<HoofHomQty>& quals, const vector<H
          qualFound = true;
       }
       if(!qualFound)
-         warning("QUALITY quantity in " + qual.oldDataset + "/" + qual.oldData +
+         warning("UNMATCHED_QUALITY", "QUALITY quantity in " + qual.oldDataset + "/" + qual.oldData +
                   " has no matching DBZ or VRAD group, omitting it");
    }
 }
@@ -682,7 +682,7 @@ void HoofHomogenizer::_checkReqDbzsVrads(const vector<HoofHomQty>& dbzs, const v
          }
       }
       else
-         warning("DBZ quantity in " + dbz.oldDataset + "/" + dbz.oldData +
+         warning("MISSING_QUALITY", "DBZ quantity in " + dbz.oldDataset + "/" + dbz.oldData +
                  " does not have the required quality groups, omitting dataset");
    }
 }
@@ -915,7 +915,7 @@ void HoofHomogenizer::checkAndWrite()
    if(conventions)
       _outFile.writeAtt<string>("/", "Conventions", conventions.value());
    else  
-      error("Conventions attribute not found");
+      error("NO_CONVENTIONS", "Conventions attribute not found");
 
    // handle the root group metadata attributes
    HoofHomQty dummy;
@@ -923,7 +923,7 @@ void HoofHomogenizer::checkAndWrite()
 
    // check if there are any quantities to write
    if(_qtys.size() == 0)
-      error("no quantities to write to output file");
+      error("NO_QUANTITIES", "no quantities to write to output file");
 
    // loop on quantities
    for(int i=0; i<_qtys.size(); i++)
@@ -935,21 +935,22 @@ void HoofHomogenizer::checkAndWrite()
       if(qty.name == "DBZ" || qty.name == "VRAD")
          _checkAndWriteQtyMetadataGroups("dataset", qty);
 
-      // handle the data group metadata attributes and copy dataset
+      // handle the data group metadata attributes
       if(qty.oldData.find("data") != string::npos)
-      {
          _checkAndWriteQtyMetadataGroups("data", qty);
-         _inFile.copyDataset(_outFile, qty.oldDataset + "/" + qty.oldData + "/data",
-            qty.newDataset + "/" + qty.newData + "/data");
-      }
 
-      // handle the quality group metadata attributes and copy dataset
+      // handle the quality group metadata attributes
       if(qty.oldData.find("quality") != string::npos)
-      {
          _checkAndWriteQtyMetadataGroups("quality", qty);      
-         _inFile.copyDataset(_outFile, qty.oldDataset + "/" + qty.oldData + "/data",
-            qty.newDataset + "/" + qty.newData + "/data");
-      }
+
+      // copy the dataset, unless the output is planned and a later stage replaces it or the output
+      // holds only superobs
+      string oldPath = qty.oldDataset + "/" + qty.oldData + "/data";
+      string newPath = qty.newDataset + "/" + qty.newData + "/data";
+      if(HoofSettings::outputMode == "SUPEROBS" || (HoofSettings::outputMode == "PLANNED" && _isReplaced(qty)))
+         _plannedCopies[newPath] = oldPath;
+      else
+         _inFile.copyDataset(_outFile, oldPath, newPath);
    }
    _outFile.flush();  
 }
@@ -1133,4 +1134,65 @@ void HoofHomogenizer::storeData()
          }
       }
    }
-}
\ No newline at end of file
+}
+/**
+   @brief Gets a dataset of the homogenized file. If copying the dataset was planned away, it is read
+      from its original place in the input file, which holds the same values.
+   @param group The dataset group in the homogenized file.
+   @param name The dataset name.
+   @return The dataset, or std::nullopt if not found.
+*/
+optional<vector2D<unsigned char>> HoofHomogenizer::_getHomDataset(const string& group, const string& name)
+{
+   auto planned = _plannedCopies.find(group + "/" + name);
+   if(planned == _plannedCopies.end())
+      return _outFile.getDataset(group, name);
+   string oldPath = planned->second;
+   std::size_t split = oldPath.rfind('/');
+   return _inFile.getDataset(oldPath.substr(0, split), oldPath.substr(split + 1));
+}
+
+/**
+   @brief Checks if dealiasing or superobing writes the dataset of a quantity again. Superobing
+      replaces data1, data2 and quality1 of DBZ datasets and data1 and quality1 of VRAD datasets,
+      dealiasing replaces data1 and quality1 of VRAD datasets.
+   @param qty The homogenization quantity.
+   @return True if a later stage replaces the dataset, false otherwise.
+*/
+bool HoofHomogenizer::_isReplaced(const HoofHomQty& qty) const
+{
+   bool dbzDataset = false;
+   bool vradDataset = false;
+   for(int i=0; i<_qtys.size(); i++)
+   {
+      if(_qtys[i].newDataset == qty.newDataset && _qtys[i].name == "DBZ")
+         dbzDataset = true;
+      if(_qtys[i].newDataset == qty.newDataset && _qtys[i].name == "VRAD")
+         vradDataset = true;
+   }
+   if(dbzDataset && HoofSettings::superobing)
+      return qty.newData == "data1" || qty.newData == "data2" || qty.newData == "quality1";
+   if(vradDataset && (HoofSettings::superobing || HoofSettings::dealiasing))
+      return qty.newData == "data1" || qty.newData == "quality1";
+   return false;
+}
+
+/**
+   @brief Copies the datasets whose copy was planned away but that no later stage wrote, so the
+      output is complete even if a stage skipped a dataset. In superob only output the data and
+      quality groups of these datasets are removed instead, so only superobed data remains.
+*/
+void HoofHomogenizer::writePlanned()
+{
+   for(auto it=_plannedCopies.begin(); it!=_plannedCopies.end(); it++)
+   {
+      std::size_t split = it->first.rfind('/');
+      string group = it->first.substr(0, split);
+      if(_outFile.hasDataset(group, it->first.substr(split + 1)))
+         continue;
+      if(HoofSettings::outputMode == "SUPEROBS")
+         _outFile.removeGroup(group);
+      else
+         _inFile.copyDataset(_outFile, it->second, it->first);
+   }
+}
@@ -9,6 +9,7 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <optional>
 #include <HoofTypes.h>
 #include <HoofWorker.h>
@@ -29,6 +30,7 @@ class HoofHomogenizer : public HoofWorker
       HoofH5File& _outFile;            ///< The output file.  
       HoofData& _data;                 ///< Object that gets filled with homogenized data for further use.
       std::vector<HoofHomQty> _qtys;   ///< A vector of sorted homogenization quantities.
+      std::map<std::string, std::string> _plannedCopies;  ///< Datasets not copied because later stages replace them, new to old path.
    
       // gets the unique namelist metadata groups by group type
       std::vector<std::string> _getNamelistMetadataGroups(const std::string& groupType) const;
@@ -86,6 +88,11 @@ class HoofHomogenizer : public HoofWorker
          const std::string& name, const double nodata); 
       // gets an attribute value of type T from the homogenized file
       template<typename T> std::optional<T> _getHomAtt(const std::string& group, const std::string& name);
+      // gets a dataset of the homogenized file, from the input file if its copy was planned away
+      std::optional<hoof::vector2D<unsigned char>> _getHomDataset(const std::string& group,
+         const std::string& name);
+      // checks if dealiasing or superobing replaces the dataset of a quantity
+      bool _isReplaced(const HoofHomQty& qty) const;
          
    public:  
       // constructor
@@ -98,6 +105,8 @@ class HoofHomogenizer : public HoofWorker
       void checkAndWrite();
       // stores homogenized data to a HoofData object for further use
       void storeData();
+      // copies the planned datasets that no later stage wrote, or removes their groups in superob only output
+      void writePlanned();
 };
 
 #endif // HOOFHOMOGENIZER_GUARD
\ No newline at end of file
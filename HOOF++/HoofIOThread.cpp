@@ -0,0 +1,160 @@
+/**
+   @file HoofIOThread.cpp
+   @author Peter Smerkol
+   @brief Contains the HoofIOThread class implementation.
+*/
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <cerrno>
+#include <semaphore.h>
+#include <H5Cpp.h>
+#include <HoofH5File.h>
+#include <HoofTrace.h>
+#include <HoofMetrics.h>
+#include <HoofArchive.h>
+#include <HoofSettings.h>
+#include <HoofIOThread.h>
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::endl;
+
+/**
+   @brief Checks if the HDF5 library is built thread-safe, which is needed to write files in the
+      background while other files are processed.
+   @return True if the library is thread-safe, false otherwise.
+*/
+bool HoofIOThread::available()
+{
+   hbool_t threadsafe = false;
+   if(H5is_library_threadsafe(&threadsafe) < 0)
+      return false;
+   return threadsafe;
+}
+
+/**
+   @brief Constructor, starts the I/O thread.
+*/
+HoofIOThread::HoofIOThread() : _head(0), _tail(0), _written(0), _stop(false)
+{
+   sem_init(&_items, 0, 0);
+   _thread = std::thread(&HoofIOThread::_run, this);
+}
+
+/**
+   @brief Destructor, writes the files that are still waiting and stops the I/O thread.
+*/
+HoofIOThread::~HoofIOThread()
+{
+   flush();
+   _stop.store(true);
+   sem_post(&_items);
+   _thread.join();
+   sem_destroy(&_items);
+}
+
+/**
+   @brief Main loop of the I/O thread. Takes output files from the ring, executes their recorded
+      writes and closes them.
+*/
+void HoofIOThread::_run()
+{
+   HoofTrace::nameThread("I/O thread");
+   while(true)
+   {
+      if(sem_wait(&_items) != 0 && errno == EINTR)
+         continue;
+
+      // an empty ring after a wake up means the thread is being stopped
+      unsigned long head = _head.load(std::memory_order_relaxed);
+      if(head == _tail.load(std::memory_order_acquire))
+      {
+         if(_stop.load())
+            return;
+         continue;
+      }
+      Output* output = _ring[head % _capacity];
+      _head.store(head + 1, std::memory_order_release);
+
+      HoofTrace::setFile(output->fileName);
+      try
+      {
+         HoofTrace::Scope scope("Write output", "stage");
+         output->file.commit();
+         output->file.close();
+         if(HoofMetrics::enabled())
+            HoofMetrics::written(std::filesystem::file_size(HoofSettings::outFolder +
+               HoofArchive::outputName(output->fileName)));
+         std::lock_guard<std::mutex> lock(_failedMutex);
+         _done.push_back(output->fileName);
+      }
+      catch(...)
+      {
+         output->file.discard();
+         std::lock_guard<std::mutex> lock(_failedMutex);
+         _failed.push_back(output->fileName);
+         cout << "Could not write output file of " << output->fileName << endl;
+      }
+      delete output;
+      HoofTrace::flush();
+      _written.fetch_add(1, std::memory_order_release);
+   }
+}
+
+/**
+   @brief Hands over an output file to the I/O thread, which executes its recorded writes and closes
+      it. Waits only if the ring is full.
+   @param file The output file with recorded writes, detached after it is handed over.
+   @param fileName Name of the input file, for messages.
+*/
+void HoofIOThread::submit(HoofH5File& file, const string& fileName)
+{
+   unsigned long tail = _tail.load(std::memory_order_relaxed);
+   if(tail - _head.load(std::memory_order_acquire) >= _capacity)
+   {
+      HoofTrace::Scope scope("Wait for free slot", "queue");
+      while(tail - _head.load(std::memory_order_acquire) >= _capacity)
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+   _ring[tail % _capacity] = new Output{file, fileName};
+   file.detach();
+   _tail.store(tail + 1, std::memory_order_release);
+   sem_post(&_items);
+}
+
+/**
+   @brief Flush barrier, waits until all handed over files are written and closed.
+   @return Names of the input files whose output could not be written since the last flush.
+*/
+vector<string> HoofIOThread::flush()
+{
+   HoofTrace::Scope scope("Wait for I/O thread", "queue");
+   while(_written.load(std::memory_order_acquire) < _tail.load(std::memory_order_relaxed))
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+   std::lock_guard<std::mutex> lock(_failedMutex);
+   vector<string> failed = _failed;
+   _failed.clear();
+   return failed;
+}
+
+/**
+   @brief Takes the files whose output the I/O thread has written and closed since the last call,
+      without waiting for the others.
+   @return Names of the input files.
+*/
+vector<string> HoofIOThread::written()
+{
+   std::lock_guard<std::mutex> lock(_failedMutex);
+   vector<string> done;
+   done.swap(_done);
+   return done;
+}
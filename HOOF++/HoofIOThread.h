@@ -0,0 +1,72 @@
+/**
+   @file HoofIOThread.h
+   @author Peter Smerkol
+   @brief Contains definition of HoofIOThread class.
+*/
+
+#ifndef HOOFIOTHREAD_GUARD
+#define HOOFIOTHREAD_GUARD
+
+#include <string>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <semaphore.h>
+#include <HoofH5File.h>
+
+/**
+   @class HoofIOThread
+   @brief Class that writes and closes output files in a background thread.
+
+   The processing thread hands over output files with their recorded writes through a lock-free
+   single producer, single consumer ring and continues with the next file. It only waits when the
+   ring is full or at the flush barrier. Needs a thread-safe HDF5 library, because the processing
+   thread keeps reading and writing other files at the same time.
+*/
+class HoofIOThread
+{
+   private:
+      /**
+         @struct Output
+         @brief Holds one output file waiting to be written.
+      */
+      struct Output
+      {
+         HoofH5File file;         ///< The output file with recorded writes.
+         std::string fileName;    ///< Name of the input file, for messages.
+      };
+
+      // members
+      static const int _capacity = 16;                 ///< Number of output files that can wait in the ring.
+      std::array<Output*, _capacity> _ring;            ///< Ring of output files waiting to be written.
+      std::atomic<unsigned long> _head;                ///< Number of output files taken by the I/O thread.
+      std::atomic<unsigned long> _tail;                ///< Number of output files handed over.
+      std::atomic<unsigned long> _written;             ///< Number of output files written and closed.
+      std::atomic<bool> _stop;                         ///< Flag that stops the I/O thread.
+      sem_t _items;                                    ///< Counts output files in the ring, wakes the I/O thread.
+      std::mutex _failedMutex;                         ///< Guards the lists of written and failed files.
+      std::vector<std::string> _failed;                ///< Files whose output could not be written.
+      std::vector<std::string> _done;                  ///< Files whose output was written, not taken yet.
+      std::thread _thread;                             ///< The I/O thread.
+
+      // main loop of the I/O thread
+      void _run();
+
+   public:
+      // checks if the HDF5 library allows writing in a background thread
+      static bool available();
+      // constructor, starts the I/O thread
+      HoofIOThread();
+      // destructor, writes the remaining files and stops the I/O thread
+      ~HoofIOThread();
+      // hands over an output file to be written and closed
+      void submit(HoofH5File& file, const std::string& fileName);
+      // waits until all handed over files are written and returns the files that failed
+      std::vector<std::string> flush();
+      // takes the files whose output was written since the last call
+      std::vector<std::string> written();
+};
+
+#endif // HOOFIOTHREAD_GUARD
@@ -0,0 +1,214 @@
+/**
+   @file HoofLog.cpp
+   @author Peter Smerkol
+   @brief Contains the HoofLog class implementation.
+*/
+
+#include <string>
+#include <array>
+#include <set>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <filesystem>
+#include <cerrno>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <HoofSettings.h>
+#include <HoofArchive.h>
+#include <HoofLog.h>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::filesystem::path;
+
+// --- initialize static members
+std::array<HoofLog::Cell, HoofLog::_capacity> HoofLog::_ring;
+std::atomic<unsigned long> HoofLog::_tail(0);
+unsigned long HoofLog::_head = 0;
+std::atomic<unsigned long> HoofLog::_written(0);
+std::atomic<bool> HoofLog::_stop(false);
+sem_t HoofLog::_items;
+std::thread HoofLog::_thread;
+std::atomic<pid_t> HoofLog::_pid(0);
+std::mutex HoofLog::_startMutex;
+std::set<string> HoofLog::_created;
+
+/**
+   @brief Escapes a string for a JSON string value.
+   @param text The string.
+   @return The escaped string.
+*/
+static string escape(const string& text)
+{
+   string escaped;
+   for(char c : text)
+   {
+      if(c == '"' || c == '\\')
+         escaped += '\\';
+      if((unsigned char)c < 0x20)
+      {
+         char code[8];
+         snprintf(code, sizeof(code), "\\u%04x", c);
+         escaped += code;
+      }
+      else
+         escaped += c;
+   }
+   return escaped;
+}
+
+/**
+   @brief Starts the sink thread of this process if it is not running. A worker process inherits the
+      state of the supervisor but not its threads, so the sink is started once per process.
+*/
+void HoofLog::_start()
+{
+   if(_pid.load(std::memory_order_acquire) == getpid())
+      return;
+   std::lock_guard<std::mutex> lock(_startMutex);
+   if(_pid.load(std::memory_order_relaxed) == getpid())
+      return;
+
+   for(int i=0; i<_capacity; i++)
+      _ring[i].sequence.store(i, std::memory_order_relaxed);
+   _tail.store(0);
+   _head = 0;
+   _written.store(0);
+   _stop.store(false);
+   _created.clear();
+   sem_init(&_items, 0, 0);
+   _thread = std::thread(&HoofLog::_run);
+   _pid.store(getpid(), std::memory_order_release);
+}
+
+/**
+   @brief Hands a record to the sink thread. Claims a slot of the ring with a compare and swap, so any
+      thread can log without a lock, and waits only if the ring is full.
+   @param record The record.
+*/
+void HoofLog::submit(Record&& record)
+{
+   _start();
+   unsigned long position = _tail.load(std::memory_order_relaxed);
+   Cell* cell;
+   while(true)
+   {
+      cell = &_ring[position % _capacity];
+      long difference = (long)cell->sequence.load(std::memory_order_acquire) - (long)position;
+      if(difference == 0 && _tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+         break;
+      if(difference < 0)
+         std::this_thread::yield();
+      if(difference != 0)
+         position = _tail.load(std::memory_order_relaxed);
+   }
+   cell->record = new Record(std::move(record));
+   cell->sequence.store(position + 1, std::memory_order_release);
+   sem_post(&_items);
+}
+
+/**
+   @brief Formats one record as a log line, as text or as a JSON object.
+   @param record The record.
+   @return The line with its newline.
+*/
+string HoofLog::_format(const Record& record)
+{
+   if(HoofSettings::logFormat == "JSON")
+      return "{\"level\":\"" + escape(record.level) + "\",\"site\":\"" + escape(record.site) +
+         "\",\"file\":\"" + escape(record.file) + "\",\"stage\":\"" + escape(record.stage) +
+         "\",\"code\":\"" + escape(record.code) + "\",\"message\":\"" + escape(record.message) + "\"}\n";
+   return record.level + ": " + record.stage + " - " + record.message + "\n";
+}
+
+/**
+   @brief Main loop of the sink thread. Takes records from the ring and appends them to the log files.
+      The log file of the current input file stays open while its records keep coming.
+*/
+void HoofLog::_run()
+{
+   int fd = -1;
+   string fdPath = "";
+   while(true)
+   {
+      if(sem_wait(&_items) != 0 && errno == EINTR)
+         continue;
+
+      // a wake up without a record means the thread is being stopped
+      if(_head == _tail.load(std::memory_order_acquire))
+      {
+         if(_stop.load())
+            break;
+         continue;
+      }
+
+      // a writer may have claimed the slot but not filled it yet
+      Cell& cell = _ring[_head % _capacity];
+      while(cell.sequence.load(std::memory_order_acquire) != _head + 1)
+         std::this_thread::yield();
+      Record* record = cell.record;
+      cell.sequence.store(_head + _capacity, std::memory_order_release);
+      _head++;
+
+      // create the log file with the first record, later records are appended
+      string logPath = HoofSettings::outFolder + path(HoofArchive::outputName(record->file)).stem().string() + ".log";
+      if(logPath != fdPath)
+      {
+         if(fd >= 0)
+            close(fd);
+         bool created = _created.count(logPath) > 0;
+         fd = open(logPath.c_str(), O_WRONLY | O_CREAT | (created ? O_APPEND : O_TRUNC), 0644);
+         fdPath = logPath;
+         _created.insert(logPath);
+      }
+      string line = _format(*record);
+      if(fd < 0 || write(fd, line.c_str(), line.size()) != (ssize_t)line.size())
+         cout << "Could not write log file " << logPath << endl;
+      delete record;
+
+      // close the log file when no more records are waiting
+      int waiting = 0;
+      sem_getvalue(&_items, &waiting);
+      if(waiting == 0 && fd >= 0)
+      {
+         close(fd);
+         fd = -1;
+         fdPath = "";
+      }
+      _written.fetch_add(1, std::memory_order_release);
+   }
+   if(fd >= 0)
+      close(fd);
+}
+
+/**
+   @brief Flush barrier, waits until all handed over records are written.
+*/
+void HoofLog::flush()
+{
+   if(_pid.load(std::memory_order_acquire) != getpid())
+      return;
+   while(_written.load(std::memory_order_acquire) < _tail.load(std::memory_order_acquire))
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+/**
+   @brief Writes the remaining records and stops the sink thread of this process.
+*/
+void HoofLog::stop()
+{
+   if(_pid.load(std::memory_order_acquire) != getpid())
+      return;
+   flush();
+   _stop.store(true);
+   sem_post(&_items);
+   _thread.join();
+   sem_destroy(&_items);
+   _pid.store(0);
+}
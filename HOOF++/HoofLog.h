@@ -0,0 +1,85 @@
+/**
+   @file HoofLog.h
+   @author Peter Smerkol
+   @brief Contains definition of HoofLog class.
+*/
+
+#ifndef HOOFLOG_GUARD
+#define HOOFLOG_GUARD
+
+#include <string>
+#include <array>
+#include <set>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <semaphore.h>
+#include <sys/types.h>
+
+/**
+   @class HoofLog
+   @brief Class that writes warnings and errors to the log files in a background thread.
+
+   Records are handed to a sink thread through a lock-free bounded ring that any thread can write to, so
+   logging only costs a few atomic operations on the processing thread. The sink creates the log file of
+   an input file when its first record arrives, so no empty log files are created and removed. Records are
+   written as text lines or as JSON lines. Each process starts its own sink on first use, so worker
+   processes are forked before any sink thread exists.
+*/
+class HoofLog
+{
+   public:
+      /**
+         @struct Record
+         @brief Holds one warning or error.
+      */
+      struct Record
+      {
+         std::string level;     ///< Warning or error tag.
+         std::string site;      ///< Radar site.
+         std::string file;      ///< Input file name.
+         std::string stage;     ///< Stage that produced the record.
+         std::string code;      ///< Short code of the message, for searching and counting.
+         std::string message;   ///< Message text.
+      };
+
+      // hands a record to the sink thread
+      static void submit(Record&& record);
+      // waits until all handed over records are written
+      static void flush();
+      // writes the remaining records and stops the sink thread
+      static void stop();
+
+   private:
+      /**
+         @struct Cell
+         @brief Holds one slot of the ring with its sequence number.
+      */
+      struct Cell
+      {
+         std::atomic<unsigned long> sequence;   ///< Sequence number that tells if the slot is free or full.
+         Record* record;                        ///< The record in the slot.
+      };
+
+      // members
+      static const int _capacity = 1024;                ///< Number of records that can wait in the ring.
+      static std::array<Cell, _capacity> _ring;         ///< Ring of records waiting to be written.
+      static std::atomic<unsigned long> _tail;          ///< Number of slots claimed by writers.
+      static unsigned long _head;                       ///< Number of records taken by the sink.
+      static std::atomic<unsigned long> _written;       ///< Number of records written.
+      static std::atomic<bool> _stop;                   ///< Flag that stops the sink thread.
+      static sem_t _items;                              ///< Counts records in the ring, wakes the sink thread.
+      static std::thread _thread;                       ///< The sink thread.
+      static std::atomic<pid_t> _pid;                   ///< Process that started the sink thread.
+      static std::mutex _startMutex;                    ///< Guards starting the sink thread.
+      static std::set<std::string> _created;            ///< Log files created by this process.
+
+      // starts the sink thread of this process if it is not running
+      static void _start();
+      // main loop of the sink thread
+      static void _run();
+      // formats one record as a log line
+      static std::string _format(const Record& record);
+};
+
+#endif // HOOFLOG_GUARD
@@ -0,0 +1,198 @@
+/**
+   @file HoofMemory.cpp
+   @author Peter Smerkol
+   @brief Contains the HoofMemory class implementation and the counting global operator new.
+*/
+
+#include <string>
+#include <atomic>
+#include <new>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <HoofSettings.h>
+#include <HoofMemory.h>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::ofstream;
+
+// --- initialize static members
+std::atomic<long long> HoofMemory::allocations(0);
+std::atomic<long long> HoofMemory::bytes(0);
+bool HoofMemory::counting = false;
+int HoofMemory::_files = 0;
+long long HoofMemory::_allocations = 0;
+long long HoofMemory::_bytes = 0;
+long HoofMemory::_peakRss = 0;
+string HoofMemory::_peakFile = "";
+long long HoofMemory::_lastAllocations = 0;
+long long HoofMemory::_lastBytes = 0;
+long HoofMemory::_lastPeakRss = 0;
+
+/**
+   @brief Global operator new that counts allocations when memory profiling is enabled. The array and
+      nothrow versions of the standard library call this one.
+   @param size Number of bytes to allocate.
+   @return Pointer to the allocated memory.
+*/
+void* operator new(std::size_t size)
+{
+   if(HoofMemory::counting)
+   {
+      HoofMemory::allocations.fetch_add(1, std::memory_order_relaxed);
+      HoofMemory::bytes.fetch_add(size, std::memory_order_relaxed);
+   }
+   if(size == 0)
+      size = 1;
+   while(true)
+   {
+      void* p = std::malloc(size);
+      if(p != nullptr)
+         return p;
+      std::new_handler handler = std::get_new_handler();
+      if(handler == nullptr)
+         throw std::bad_alloc();
+      handler();
+   }
+}
+
+/**
+   @brief Global operator delete matching the counting operator new.
+   @param p Pointer to the memory to free.
+*/
+void operator delete(void* p) noexcept
+{
+   std::free(p);
+}
+
+/**
+   @brief Global sized operator delete matching the counting operator new.
+   @param p Pointer to the memory to free.
+*/
+void operator delete(void* p, std::size_t) noexcept
+{
+   std::free(p);
+}
+
+/**
+   @brief Formats a number of kB as MB.
+   @param kb The number of kB.
+   @return The formatted number.
+*/
+static string mb(double kb)
+{
+   char text[32];
+   snprintf(text, sizeof(text), "%.1f MB", kb / 1024.0);
+   return text;
+}
+
+/**
+   @brief Starts counting allocations if memory profiling is enabled in the namelist.
+*/
+void HoofMemory::start()
+{
+   counting = HoofSettings::memoryProfiling;
+}
+
+/**
+   @brief Reads the allocation counters, the resident set size from /proc/self/statm and its high-water
+      mark from /proc/self/status, then resets the high-water mark through /proc/self/clear_refs. Where
+      the reset is not allowed the high-water mark is the one since the start of the process.
+   @return The reading, all zeros if memory profiling is disabled.
+*/
+HoofMemory::Sample HoofMemory::read()
+{
+   Sample sample = {0, 0, 0, 0};
+   if(!counting)
+      return sample;
+
+   sample.allocations = allocations.load(std::memory_order_relaxed);
+   sample.bytes = bytes.load(std::memory_order_relaxed);
+
+   long pages = 0;
+   long resident = 0;
+   ifstream statm("/proc/self/statm");
+   if(statm >> pages >> resident)
+      sample.rss = resident * (sysconf(_SC_PAGESIZE) / 1024);
+
+   ifstream status("/proc/self/status");
+   string line;
+   while(std::getline(status, line))
+   {
+      if(line.compare(0, 6, "VmHWM:") == 0)
+         sample.peakRss = std::atol(line.c_str() + 6);
+   }
+   if(sample.peakRss == 0)
+   {
+      rusage usage;
+      if(getrusage(RUSAGE_SELF, &usage) == 0)
+         sample.peakRss = usage.ru_maxrss;
+   }
+
+   ofstream clear("/proc/self/clear_refs");
+   clear << "5";
+   return sample;
+}
+
+/**
+   @brief Formats the allocations between two readings and the peak resident memory of the later one.
+   @param before The reading at the start of a stage.
+   @param after The reading at the end of a stage.
+   @return The formatted allocations and memory, empty if memory profiling is disabled.
+*/
+string HoofMemory::format(const Sample& before, const Sample& after)
+{
+   if(!counting)
+      return "";
+   return "   {" + std::to_string(after.allocations - before.allocations) + " allocations, " +
+      mb((after.bytes - before.bytes) / 1024.0) + " allocated, peak RSS " + mb(after.peakRss) + "}";
+}
+
+/**
+   @brief Adds the allocations and the peak resident memory of one file to the summary of the run.
+   @param fileName Name of the file.
+   @param fileAllocations Number of allocations while processing the file.
+   @param fileBytes Bytes allocated while processing the file.
+   @param peakRss Peak resident memory while processing the file in kB.
+*/
+void HoofMemory::record(const string& fileName, long long fileAllocations, long long fileBytes, long peakRss)
+{
+   _files++;
+   _allocations += fileAllocations;
+   _bytes += fileBytes;
+   if(peakRss > _peakRss)
+   {
+      _peakRss = peakRss;
+      _peakFile = fileName;
+   }
+   _lastAllocations = fileAllocations;
+   _lastBytes = fileBytes;
+   _lastPeakRss = peakRss;
+}
+
+/**
+   @brief Gives the values of the last recorded file, as sent by worker processes to the supervisor.
+   @return Allocations, bytes and peak resident memory separated by spaces.
+*/
+string HoofMemory::lastRecord()
+{
+   return std::to_string(_lastAllocations) + " " + std::to_string(_lastBytes) + " " + std::to_string(_lastPeakRss);
+}
+
+/**
+   @brief Prints the summary of the run, with the highest peak resident memory of a file, which is what a
+      worker process needs.
+*/
+void HoofMemory::printSummary()
+{
+   if(!counting || _files == 0)
+      return;
+   cout << "Memory: " << _allocations / _files << " allocations and " << mb(_bytes / 1024.0 / _files) <<
+      " allocated per file on average, peak RSS " << mb(_peakRss) << " (" << _peakFile << ")" << endl;
+}
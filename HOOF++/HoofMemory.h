@@ -0,0 +1,67 @@
+/**
+   @file HoofMemory.h
+   @author Peter Smerkol
+   @brief Contains definition of HoofMemory class.
+*/
+
+#ifndef HOOFMEMORY_GUARD
+#define HOOFMEMORY_GUARD
+
+#include <string>
+#include <atomic>
+
+/**
+   @class HoofMemory
+   @brief Class that profiles allocations and resident memory of the stages.
+
+   With memory profiling enabled, the global operator new counts allocations and allocated bytes and every
+   reading takes the resident set size and its high-water mark from /proc. The high-water mark is reset
+   after each reading, so the next reading gives the peak of one stage. Only C++ allocations are counted,
+   memory allocated by HDF5 and GSL with malloc only shows up in the resident set size.
+*/
+class HoofMemory
+{
+   public:
+      /**
+         @struct Sample
+         @brief Holds one reading of the allocation counters and the resident memory.
+      */
+      struct Sample
+      {
+         long long allocations;  ///< Number of allocations since the start.
+         long long bytes;        ///< Bytes allocated since the start.
+         long rss;               ///< Resident set size in kB.
+         long peakRss;           ///< Highest resident set size in kB since the previous reading.
+      };
+
+      // counters updated by the global operator new
+      static std::atomic<long long> allocations;  ///< Number of allocations since the start.
+      static std::atomic<long long> bytes;        ///< Bytes allocated since the start.
+      static bool counting;                       ///< Flag that enables counting in operator new.
+
+      // starts counting allocations if memory profiling is enabled in the namelist
+      static void start();
+      // reads the allocation counters and the resident memory and resets the high-water mark
+      static Sample read();
+      // formats the allocations between two readings and the peak resident memory of the later one
+      static std::string format(const Sample& before, const Sample& after);
+      // adds the allocations and peak resident memory of one file to the summary of the run
+      static void record(const std::string& fileName, long long fileAllocations, long long fileBytes, long peakRss);
+      // gives the values of the last recorded file, as sent by worker processes
+      static std::string lastRecord();
+      // prints the summary of the run
+      static void printSummary();
+
+   private:
+      // members
+      static int _files;                  ///< Number of files in the summary.
+      static long long _allocations;      ///< Allocations of all files in the summary.
+      static long long _bytes;            ///< Bytes allocated by all files in the summary.
+      static long _peakRss;               ///< Highest peak resident memory of a file in kB.
+      static std::string _peakFile;       ///< File with the highest peak resident memory.
+      static long long _lastAllocations;  ///< Allocations of the last recorded file.
+      static long long _lastBytes;        ///< Bytes allocated by the last recorded file.
+      static long _lastPeakRss;           ///< Peak resident memory of the last recorded file in kB.
+};
+
+#endif // HOOFMEMORY_GUARD
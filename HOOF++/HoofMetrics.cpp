@@ -0,0 +1,293 @@
+/**
+   @file HoofMetrics.cpp
+   @author Peter Smerkol
+   @brief Contains the HoofMetrics class implementation.
+*/
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+#include <HoofTypes.h>
+#include <HoofSettings.h>
+#include <HoofMetrics.h>
+
+using std::string;
+using std::vector;
+using std::map;
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::istringstream;
+using std::to_string;
+using namespace hoof;
+
+// --- initialize static members
+std::mutex HoofMetrics::_mutex;
+Time HoofMetrics::_start = Clock::now();
+long long HoofMetrics::_processed = 0;
+long long HoofMetrics::_failed = 0;
+double HoofMetrics::_bytesRead = 0.0;
+double HoofMetrics::_bytesWritten = 0.0;
+double HoofMetrics::_busySeconds = 0.0;
+int HoofMetrics::_queueDepth = 0;
+map<string, HoofMetrics::Histogram> HoofMetrics::_stages;
+HoofMetrics::Histogram HoofMetrics::_latency;
+string HoofMetrics::_record = "";
+
+/**
+   @brief Formats a number for the text format.
+   @param value The number.
+   @return The formatted number.
+*/
+static string number(double value)
+{
+   char text[32];
+   snprintf(text, sizeof(text), "%.9g", value);
+   return text;
+}
+
+/**
+   @brief Creates an empty histogram.
+   @param bounds Upper bounds of the buckets, without +Inf.
+   @return The histogram.
+*/
+HoofMetrics::Histogram HoofMetrics::_histogram(const vector<double>& bounds)
+{
+   return {bounds, vector<long long>(bounds.size(), 0), 0.0, 0};
+}
+
+/**
+   @brief Adds an observation to a histogram.
+   @param histogram The histogram.
+   @param value The observed value.
+*/
+void HoofMetrics::_observe(Histogram& histogram, double value)
+{
+   for(int i=0; i<histogram.bounds.size(); i++)
+   {
+      if(value <= histogram.bounds[i])
+         histogram.counts[i]++;
+   }
+   histogram.sum += value;
+   histogram.count++;
+}
+
+/**
+   @brief Formats a histogram in the text format, with buckets, sum and count.
+   @param name Name of the metric.
+   @param labels Labels of the metric without braces, can be empty.
+   @param histogram The histogram.
+   @return The formatted lines.
+*/
+string HoofMetrics::_format(const string& name, const string& labels, const Histogram& histogram)
+{
+   string prefix = labels.empty() ? "" : labels + ",";
+   string text;
+   for(int i=0; i<histogram.bounds.size(); i++)
+      text += name + "_bucket{" + prefix + "le=\"" + number(histogram.bounds[i]) + "\"} " +
+         to_string(histogram.counts[i]) + "\n";
+   text += name + "_bucket{" + prefix + "le=\"+Inf\"} " + to_string(histogram.count) + "\n";
+   string braces = labels.empty() ? "" : "{" + labels + "}";
+   text += name + "_sum" + braces + " " + number(histogram.sum) + "\n";
+   text += name + "_count" + braces + " " + to_string(histogram.count) + "\n";
+   return text;
+}
+
+/**
+   @brief Checks if a metrics file is set in the namelist.
+   @return True if metrics are enabled, false otherwise.
+*/
+bool HoofMetrics::enabled()
+{
+   return HoofSettings::metricsFile != "NONE";
+}
+
+/**
+   @brief Starts the metrics of a batch.
+*/
+void HoofMetrics::start()
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   _start = Clock::now();
+   _latency = _histogram({10, 30, 60, 120, 300, 600, 1800, 3600});
+}
+
+/**
+   @brief Records the duration of a stage of the file being processed.
+   @param stage Name of the stage.
+   @param seconds Duration of the stage in seconds.
+*/
+void HoofMetrics::stage(const string& stage, double seconds)
+{
+   if(enabled())
+      _record += ";" + stage + "=" + number(seconds);
+}
+
+/**
+   @brief Records the totals of the file being processed, which completes its record.
+   @param seconds Processing time of the file in seconds.
+   @param bytesRead Bytes of the input file.
+   @param bytesWritten Bytes of the output file, 0 if the I/O thread writes it.
+*/
+void HoofMetrics::file(double seconds, double bytesRead, double bytesWritten)
+{
+   if(enabled())
+      _record = number(seconds) + " " + number(bytesRead) + " " + number(bytesWritten) + _record;
+}
+
+/**
+   @brief Takes the record of the last processed file, to be added to the run totals by the process
+      that runs the batch.
+   @return The record, empty if metrics are disabled.
+*/
+string HoofMetrics::take()
+{
+   string record;
+   record.swap(_record);
+   return record;
+}
+
+/**
+   @brief Adds a file record to the run totals.
+   @param record The record as returned by take().
+*/
+void HoofMetrics::add(const string& record)
+{
+   if(!enabled() || record.empty())
+      return;
+   std::lock_guard<std::mutex> lock(_mutex);
+   istringstream fields(record);
+   string field;
+   std::getline(fields, field, ';');
+   double seconds = 0.0;
+   double bytesRead = 0.0;
+   double bytesWritten = 0.0;
+   istringstream(field) >> seconds >> bytesRead >> bytesWritten;
+   _processed++;
+   _busySeconds += seconds;
+   _bytesRead += bytesRead;
+   _bytesWritten += bytesWritten;
+   while(std::getline(fields, field, ';'))
+   {
+      size_t equals = field.rfind('=');
+      if(equals == string::npos)
+         continue;
+      string stage = field.substr(0, equals);
+      if(_stages.count(stage) == 0)
+         _stages[stage] = _histogram({0.01, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10});
+      _observe(_stages[stage], std::stod(field.substr(equals+1)));
+   }
+}
+
+/**
+   @brief Adds bytes written by the I/O thread to the run totals.
+   @param bytes Bytes of the output file.
+*/
+void HoofMetrics::written(double bytes)
+{
+   if(!enabled())
+      return;
+   std::lock_guard<std::mutex> lock(_mutex);
+   _bytesWritten += bytes;
+}
+
+/**
+   @brief Records the arrival to output latency of a finished file and writes the metrics file.
+   @param seconds The latency in seconds.
+*/
+void HoofMetrics::latency(double seconds)
+{
+   if(!enabled())
+      return;
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _observe(_latency, seconds);
+   }
+   write();
+}
+
+/**
+   @brief Counts a failed file and writes the metrics file.
+*/
+void HoofMetrics::failed()
+{
+   if(!enabled())
+      return;
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _failed++;
+   }
+   write();
+}
+
+/**
+   @brief Sets the number of files waiting to be processed.
+   @param depth Number of waiting files.
+*/
+void HoofMetrics::queueDepth(int depth)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   _queueDepth = depth;
+}
+
+/**
+   @brief Writes the metrics file. It is written to a temporary file in the same folder, which the
+      textfile collector ignores, and renamed over the metrics file.
+*/
+void HoofMetrics::write()
+{
+   if(!enabled())
+      return;
+   std::lock_guard<std::mutex> lock(_mutex);
+   double elapsed = std::chrono::duration<double>(Clock::now() - _start).count();
+   double utilization = elapsed > 0.0 ? _busySeconds / (std::max(1, HoofSettings::workers) * elapsed) : 0.0;
+
+   string text;
+   text += "# HELP hoof_files_processed_total Files processed successfully.\n";
+   text += "# TYPE hoof_files_processed_total counter\n";
+   text += "hoof_files_processed_total " + to_string(_processed) + "\n";
+   text += "# HELP hoof_files_failed_total Files that failed or crashed a worker.\n";
+   text += "# TYPE hoof_files_failed_total counter\n";
+   text += "hoof_files_failed_total " + to_string(_failed) + "\n";
+   text += "# HELP hoof_stage_duration_seconds Duration of the processing stages.\n";
+   text += "# TYPE hoof_stage_duration_seconds histogram\n";
+   for(auto& [stage, histogram] : _stages)
+      text += _format("hoof_stage_duration_seconds", "stage=\"" + stage + "\"", histogram);
+   text += "# HELP hoof_arrival_to_output_latency_seconds Time from the arrival of a volume to its output.\n";
+   text += "# TYPE hoof_arrival_to_output_latency_seconds histogram\n";
+   text += _format("hoof_arrival_to_output_latency_seconds", "", _latency);
+   text += "# HELP hoof_read_bytes_total Bytes of input files read.\n";
+   text += "# TYPE hoof_read_bytes_total counter\n";
+   text += "hoof_read_bytes_total " + number(_bytesRead) + "\n";
+   text += "# HELP hoof_written_bytes_total Bytes of output files written.\n";
+   text += "# TYPE hoof_written_bytes_total counter\n";
+   text += "hoof_written_bytes_total " + number(_bytesWritten) + "\n";
+   text += "# HELP hoof_queue_depth Files waiting to be processed.\n";
+   text += "# TYPE hoof_queue_depth gauge\n";
+   text += "hoof_queue_depth " + to_string(_queueDepth) + "\n";
+   text += "# HELP hoof_worker_utilization Fraction of the batch time the workers spent processing files.\n";
+   text += "# TYPE hoof_worker_utilization gauge\n";
+   text += "hoof_worker_utilization " + number(utilization) + "\n";
+   text += "# HELP hoof_last_update_timestamp_seconds Time of the last update of this file.\n";
+   text += "# TYPE hoof_last_update_timestamp_seconds gauge\n";
+   text += "hoof_last_update_timestamp_seconds " +
+      to_string(std::chrono::duration_cast<std::chrono::seconds>(WallClock::now().time_since_epoch()).count()) + "\n";
+
+   string tmpPath = HoofSettings::metricsFile + "." + to_string(getpid()) + ".tmp";
+   ofstream file(tmpPath);
+   file << text;
+   file.close();
+   if(!file || std::rename(tmpPath.c_str(), HoofSettings::metricsFile.c_str()) != 0)
+   {
+      cout << "Could not write metrics file " << HoofSettings::metricsFile << endl;
+      std::remove(tmpPath.c_str());
+   }
+}
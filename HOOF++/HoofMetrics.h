@@ -0,0 +1,86 @@
+/**
+   @file HoofMetrics.h
+   @author Peter Smerkol
+   @brief Contains definition of HoofMetrics class.
+*/
+
+#ifndef HOOFMETRICS_GUARD
+#define HOOFMETRICS_GUARD
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <HoofTypes.h>
+
+/**
+   @class HoofMetrics
+   @brief Class that keeps run metrics and writes them in the Prometheus text format for the textfile
+      collector of node_exporter.
+
+   The processor records the stage durations and bytes of each file into a file record. The process that
+   runs the batch (the main process or the supervisor of the workers) adds the records, latencies and
+   failures to the run totals and rewrites the metrics file after every file and at the end of the batch.
+   The file is written to a temporary name and renamed, so the collector never reads a partial file.
+*/
+class HoofMetrics
+{
+   private:
+      /**
+         @struct Histogram
+         @brief Holds a cumulative Prometheus histogram.
+      */
+      struct Histogram
+      {
+         std::vector<double> bounds;        ///< Upper bounds of the buckets, without +Inf.
+         std::vector<long long> counts;     ///< Number of observations in each bucket and below.
+         double sum;                        ///< Sum of the observations.
+         long long count;                   ///< Number of observations.
+      };
+
+      // members
+      static std::mutex _mutex;                          ///< Guards the metrics, the I/O thread adds written bytes.
+      static hoof::Time _start;                          ///< Start of the batch.
+      static long long _processed;                       ///< Number of successfully processed files.
+      static long long _failed;                          ///< Number of files that failed.
+      static double _bytesRead;                          ///< Bytes of input files read.
+      static double _bytesWritten;                       ///< Bytes of output files written.
+      static double _busySeconds;                        ///< Time spent processing files, summed over workers.
+      static int _queueDepth;                            ///< Number of files waiting to be processed.
+      static std::map<std::string, Histogram> _stages;   ///< Duration histograms per stage.
+      static Histogram _latency;                         ///< Arrival to output latency histogram.
+      static std::string _record;                        ///< Record of the file being processed.
+
+      // creates an empty histogram with the given bucket bounds
+      static Histogram _histogram(const std::vector<double>& bounds);
+      // adds an observation to a histogram
+      static void _observe(Histogram& histogram, double value);
+      // formats a histogram in the text format
+      static std::string _format(const std::string& name, const std::string& labels, const Histogram& histogram);
+
+   public:
+      // checks if metrics are enabled in the namelist
+      static bool enabled();
+      // starts the metrics of a batch
+      static void start();
+      // records the duration of a stage of the file being processed
+      static void stage(const std::string& stage, double seconds);
+      // records the totals of the file being processed
+      static void file(double seconds, double bytesRead, double bytesWritten);
+      // takes the record of the last processed file
+      static std::string take();
+      // adds a file record to the run totals
+      static void add(const std::string& record);
+      // adds bytes written by the I/O thread to the run totals
+      static void written(double bytes);
+      // records the arrival to output latency of a finished file
+      static void latency(double seconds);
+      // counts a failed file
+      static void failed();
+      // sets the number of files waiting to be processed
+      static void queueDepth(int depth);
+      // writes the metrics file
+      static void write();
+};
+
+#endif // HOOFMETRICS_GUARD
@@ -0,0 +1,433 @@
+/**
+   @file HoofProcessor.cpp
+   @author Peter Smerkol
+   @brief Contains the HoofProcessor class implementation.
+*/
+
+#include <string>
+#include <iostream>
+#include <filesystem>
+#include <chrono>
+#include <vector>
+#include <future>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <execinfo.h>
+#include <HoofTypes.h>
+#include <HoofAux.h>
+#include <HoofSettings.h>
+#include <HoofWorker.h>
+#include <HoofData.h>
+#include <HoofH5File.h>
+#include <HoofHomogenizer.h>
+#include <HoofDealiaser.h>
+#include <HoofSuperober.h>
+#include <HoofArchive.h>
+#include <HoofIOThread.h>
+#include <HoofCounters.h>
+#include <HoofMemory.h>
+#include <HoofTrace.h>
+#include <HoofMetrics.h>
+#include <HoofLog.h>
+#include <HoofShm.h>
+#include <HoofProcessor.h>
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::endl;
+using std::filesystem::path;
+using std::filesystem::file_size;
+using std::filesystem::remove;
+using std::chrono::duration_cast;
+using namespace hoof;
+
+// stages that start at each timing point, HDF5 operations are accounted to them
+static const char* stageNames[15] = {"Input file reading", "Homogenization", "Homogenization check/write",
+   "Storing homogenized data", "Checking dealiasing data", "Calculating wind model theory",
+   "Determining height sectors", "Calculating wind models", "Dealiasing", "Writing dealiased data",
+   "Checking superobing data", "Preparing superobed metadata", "Superobing", "Writing superobed data",
+   "Planned output and closing"};
+
+/**
+   @brief Prints the stack trace.
+*/
+static void printStack()
+{
+   const int maxLines = 100;
+   void* addrlist[maxLines];
+   int addrlen = backtrace(addrlist, maxLines);
+   if (addrlen == 0) {
+      std::cerr << "  <empty stack>" << endl;
+      return;
+   }
+   char** symbollist = backtrace_symbols(addrlist, addrlen);
+   std::cerr << "Stack trace:" << endl;
+   for (int i = 0; i < addrlen; ++i) {
+      std::cerr << symbollist[i] << endl;
+   }
+   free(symbollist);
+}
+
+/**
+   @brief Helper function that handles errors. It writes error to output and closes all open files.
+   @param worker The worker object to handle.
+   @param inFile The input file to close.
+   @param  outFile The output file to close, with [Atomic output] it is removed.
+   @param fileName Name of the input file, for the log.
+   @param site Radar site of the input file, for the log.
+   @return True if errors occured, otherwise false.
+ */
+bool HoofProcessor::_handleErrors(HoofWorker& worker, HoofH5File& inFile, HoofH5File& outFile,
+   const string& fileName, const string& site) const
+{
+   if(worker.errors.size() != 0)
+   {
+      worker.output(fileName, site);
+      outFile.discard();
+      inFile.close();
+      return true;
+   }
+   return false;
+}
+
+/**
+   @brief Starts reading an archived input file into memory in a background thread, so it is
+      decompressed while other files are processed. Plain files and files already being read are ignored.
+   @param fileName Name of the file in the input folder.
+*/
+void HoofProcessor::prefetch(const string& fileName) const
+{
+   if(!HoofArchive::isArchived(fileName) || _prefetched.count(fileName))
+      return;
+   _prefetched[fileName] = std::async(std::launch::async, HoofArchive::read, fileName);
+}
+
+/**
+   @brief Opens an input file for reading, from the image read ahead by prefetch() if there is one.
+   @param fileName Name of the file in the input folder.
+   @return The opened file.
+*/
+HoofH5File HoofProcessor::_openInput(const string& fileName) const
+{
+   auto it = _prefetched.find(fileName);
+   if(it == _prefetched.end())
+      return HoofArchive::open(fileName);
+   vector<char> image;
+   {
+      HoofTrace::Scope scope("Wait for read ahead", "queue");
+      image = it->second.get();
+   }
+   _prefetched.erase(it);
+   return HoofH5File(image, HoofArchive::memberName(fileName));
+}
+
+/**
+   @brief Dealiases and superobs the homogenized data of a file, with the kernels calculating in T.
+   @param data The homogenized data, receives the dealiased and superobed data.
+   @param outFile The output file.
+   @param fileName Name of the file in the input folder.
+   @param outName Name of the output file.
+   @param mark Marks the end of a stage for the timings.
+*/
+template<typename T>
+void HoofProcessor::_dealiasAndSuperob(HoofData& data, HoofH5File& outFile, const string& fileName,
+   const string& outName, const std::function<void(int)>& mark) const
+{
+   // dealiasing
+   if(HoofSettings::dealiasing)
+   {
+      // check if VRAD data is ok for dealiasing
+      cout << "Checking VRAD data for dealiasing ..." << endl;
+      HoofDealiaser<T> dealiaser(data, outFile);
+      dealiaser.checkData();
+      mark(5);
+
+      // calculate quantities used in the minimization to get the wind model
+      cout << "Calculating wind model quantities ..." << endl;
+      dealiaser.calculateWindModelQtys();
+      mark(6);
+
+      // determine height sectors
+      cout << "Determining height sectors ..." << endl;
+      dealiaser.determineHeightSectors();
+      mark(7);
+
+      // calculate wind models
+      cout << "Calculating wind models ..." << endl;
+      dealiaser.calculateWindModels();
+      mark(8);
+
+      // dealias
+      cout << "Dealiasing ..." << endl;
+      dealiaser.dealias();
+      mark(9);
+
+      // write dealiased data, unless the output is planned and superobing replaces it
+      if(HoofSettings::outputMode == "FULL" || !HoofSettings::superobing)
+      {
+         cout << "Writing dealiased data to file ..." << endl;
+         dealiaser.write();
+      }
+      mark(10);
+
+      // write warnings from dealiasing to log
+      cout << "Writing warnings to log ..." << endl;
+      dealiaser.output(fileName, data.site);
+   }
+
+   // superobing
+   if(HoofSettings::superobing)
+   {
+      // check if data is ok for superobing
+      cout << "Checking data for superobing ..." << endl;
+      HoofSuperober<T> superober(data, outFile);
+      superober.checkData();
+      mark(11);
+
+      // prepare superobed metadata
+      cout << "Preparing superobed metadata ..." << endl;
+      superober.prepareMetadata();
+      mark(12);
+
+      // superob
+      cout << "Superobing ..." << endl;
+      superober.superob();
+      mark(13);
+
+      // hand the superobs to a consumer on the same node before the output file is written
+      if(HoofShm::enabled())
+      {
+         HoofTrace::Scope scope("Publish superobs", "io");
+         HoofShm::publish(outName, data);
+      }
+
+      // write superobed data
+      cout << "Writing superobed data ..." << endl;
+      superober.write();
+      mark(14);
+   }
+}
+
+/**
+   @brief Processes one file from the input folder and writes the results to the output folder.
+   @param fileName Name of the file in the input folder.
+   @param result If not null, receives the homogenized, dealiased and superobed data of the file, so
+      callers in the same process do not have to read the output file back.
+   @return True if the file was processed successfully, false otherwise.
+*/
+bool HoofProcessor::process(const string& fileName, HoofData* result) const
+{
+   // --- determine file paths and remove the log file of an earlier run, the log sink creates it with the
+   // first warning, files from tar archives are written with the archive name
+   Clock clock;
+   string outName = HoofArchive::outputName(fileName);
+   string stem = path(outName).stem().string();
+   string outFilePath = HoofSettings::outFolder + outName;
+   std::error_code ignored;
+   remove(HoofSettings::outFolder + stem + ".log", ignored);
+   cout << "--------------- processing file " << fileName << endl;
+   HoofTrace::setFile(fileName);
+
+   // --- a file that failed leaves its stage records behind, they must not go into this file's record
+   HoofMetrics::take();
+
+   // --- initialize timers and hardware counters and get beginning time
+   Time beginTime = clock.now();
+   Time timer[15];
+   HoofCounters counters;
+   HoofCounters::Sample samples[15];
+   HoofMemory::Sample memory[15] = {};
+   auto mark = [&](int i)
+   {
+      timer[i] = clock.now();
+      samples[i] = counters.read();
+      memory[i] = HoofMemory::read();
+      HoofH5File::setStage(stageNames[i]);
+   };
+
+   // --- the HDF5 operations are printed and reset however processing of the file ends
+   struct AccountsPrinter
+   {
+      ~AccountsPrinter() { HoofH5File::printAccounts(); }
+   } accountsPrinter;
+
+   // --- open the data object, determine the site name and open the input and output HDF5 files, an
+   // unreadable or corrupt archive member or a name too short for the site fails only this file
+   mark(0);
+   cout << "Reading input file ..." << endl;
+   HoofData data;
+   HoofH5File inFile;
+   HoofH5File outFile;
+   try
+   {
+   data.site = stem.substr(stem.length()-5);
+   inFile = _openInput(fileName);
+   outFile = HoofH5File(outFilePath.c_str(), HoofSettings::outputInMemory ? "memory" : "write");
+   mark(1);
+
+   // --- homogenize data
+   cout << "Homogenizing data ..." << endl;
+   HoofHomogenizer homogenizer(inFile, outFile, data);
+   homogenizer.sort();
+   mark(2);
+
+   // check that required attributes are present in homogenized data
+   cout << "Checking and writing homogenized data to file ..." << endl;
+   homogenizer.checkAndWrite();
+   if(_handleErrors(homogenizer, inFile, outFile, fileName, data.site))
+      return false;
+   mark(3);
+
+   // write the homogenized data needed by dealiasing and superobing to the data object
+   if(HoofSettings::dealiasing || HoofSettings::superobing)
+   {
+      cout << "Storing homogenized data for further use ..." << endl;
+      homogenizer.storeData();
+      if(_handleErrors(homogenizer, inFile, outFile, fileName, data.site))
+         return false;
+      mark(4);
+   }
+
+   // write warnings from homogenization to log
+   cout << "Writing warnings to log ..." << endl;
+   homogenizer.output(fileName, data.site);
+
+   // from here on only record the output writes, the I/O thread executes them after processing
+   if(HoofSettings::writeBehind)
+      outFile.defer();
+
+   // dealiasing and superobing in the chosen precision
+   if(HoofSettings::precision == "FLOAT32")
+      _dealiasAndSuperob<float>(data, outFile, fileName, outName, mark);
+   else
+      _dealiasAndSuperob<double>(data, outFile, fileName, outName, mark);
+
+   // with planned or superob only output, complete the datasets that no later stage wrote
+   if(HoofSettings::outputMode != "FULL")
+      homogenizer.writePlanned();
+   }
+   catch(const std::exception& e)
+   {
+      cout << "Unknown error: " << e.what() << endl;
+      printStack();
+      outFile.discard();
+      return false;
+   }
+   catch(...)
+   {
+      cout << "Unknown error " << endl;
+      printStack();
+      outFile.discard();
+      return false;
+   }
+
+   // print timings and hardware counters of the stages and collect the counters for the CSV file
+   string csv;
+   auto stage = [&](const string& label, int from, int to)
+   {
+      HoofTrace::event(label.substr(0, label.size()-1), "stage", HoofTrace::micros(timer[from]),
+         HoofTrace::micros(timer[to]));
+      HoofMetrics::stage(label.substr(0, label.size()-1), std::chrono::duration<double>(timer[to]-timer[from]).count());
+      if(HoofSettings::printConsoleTiming)
+         cout << "   " << label << string(32 - label.size(), ' ') <<
+            duration_cast<Ms>(timer[to]-timer[from]).count() << " ms" <<
+            HoofCounters::format(samples[from], samples[to]) << HoofMemory::format(memory[from], memory[to]) << endl;
+      if(counters.available())
+         csv += fileName + "," + label.substr(0, label.size()-1) + "," +
+            std::to_string(duration_cast<Ms>(timer[to]-timer[from]).count()) + "," +
+            HoofCounters::csv(samples[from], samples[to]) + "\n";
+   };
+   if(HoofSettings::printConsoleTiming)
+      cout << "Timings:" << endl;
+   stage("Input file reading:", 0, 1);
+   stage("Homogenization:", 1, 2);
+   stage("Homogenization check/write:", 2, 3);
+   if(HoofSettings::dealiasing || HoofSettings::superobing)
+      stage("Storing homogenized data:", 3, 4);
+   if(HoofSettings::dealiasing)
+   {
+      stage("Checking dealiasing data:", 4, 5);
+      stage("Calculating wind model theory:", 5, 6);
+      stage("Determining height sectors:", 6, 7);
+      stage("Calculating wind models:", 7, 8);
+      stage("Dealiasing:", 8, 9);
+      stage("Writing dealiased data:", 9, 10);
+   }
+   if(HoofSettings::superobing)
+   {
+      stage("Checking superobing data:", HoofSettings::dealiasing ? 10 : 4, 11);
+      stage("Preparing superobed metadata:", 11, 12);
+      stage("Superobing:", 12, 13);
+      stage("Writing superobed data:", 13, 14);
+   }
+
+   // close the files, with write behind the I/O thread writes and closes the output file
+   inFile.close();
+   if(HoofSettings::writeBehind)
+   {
+      if(!_ioThread)
+         _ioThread = std::make_unique<HoofIOThread>();
+      _ioThread->submit(outFile, fileName);
+   }
+   else
+   {
+      try
+      {
+         outFile.close();
+      }
+      catch(const std::exception& e)
+      {
+         cout << e.what() << endl;
+         return false;
+      }
+   }
+   Time endTime = clock.now();
+   HoofCounters::Sample endSample = counters.read();
+   HoofMemory::Sample endMemory = HoofMemory::read();
+   for(int i=1; i<15; i++)
+      endMemory.peakRss = std::max(endMemory.peakRss, memory[i].peakRss);
+   cout << "Analysis time:   " << duration_cast<Ms>(endTime - beginTime).count() << " ms" <<
+      HoofCounters::format(samples[0], endSample) << HoofMemory::format(memory[0], endMemory) << endl;
+   HoofMemory::record(fileName, endMemory.allocations - memory[0].allocations, endMemory.bytes - memory[0].bytes,
+      endMemory.peakRss);
+   if(counters.available())
+   {
+      csv += fileName + ",Total," + std::to_string(duration_cast<Ms>(endTime - beginTime).count()) + "," +
+         HoofCounters::csv(samples[0], endSample) + "\n";
+      HoofCounters::appendCsv(csv);
+   }
+   if(HoofMetrics::enabled())
+      HoofMetrics::file(std::chrono::duration<double>(endTime - beginTime).count(), HoofArchive::size(fileName),
+         HoofSettings::writeBehind ? 0.0 : (double)file_size(outFilePath));
+   HoofTrace::event("Process file", "stage", HoofTrace::micros(beginTime), HoofTrace::micros(endTime));
+   HoofTrace::flush();
+   HoofTrace::setFile("");
+   if(result != nullptr)
+      *result = std::move(data);
+   return true;
+}
+
+/**
+   @brief Flush barrier, waits until the I/O thread has written all output files.
+   @return Names of the files whose output could not be written.
+*/
+vector<string> HoofProcessor::flush() const
+{
+   if(!_ioThread)
+      return vector<string>();
+   return _ioThread->flush();
+}
+
+/**
+   @brief Takes the files whose output the I/O thread has written since the last call.
+   @return Names of the files, empty without write behind.
+*/
+vector<string> HoofProcessor::written() const
+{
+   if(!_ioThread)
+      return vector<string>();
+   return _ioThread->written();
+}
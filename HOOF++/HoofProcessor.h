@@ -0,0 +1,56 @@
+/**
+   @file HoofProcessor.h
+   @author Peter Smerkol
+   @brief Contains definition of HoofProcessor class.
+*/
+
+#ifndef HOOFPROCESSOR_GUARD
+#define HOOFPROCESSOR_GUARD
+
+#include <string>
+#include <vector>
+#include <map>
+#include <future>
+#include <memory>
+#include <functional>
+#include <HoofWorker.h>
+#include <HoofH5File.h>
+#include <HoofIOThread.h>
+#include <HoofData.h>
+
+/**
+   @class HoofProcessor
+   @brief Class that runs homogenization, dealiasing and superobing on one input file.
+
+   The same object is used for processing files in the main process and in worker processes. Archived
+   input files can be read ahead in background threads while another file is processed, and with write
+   behind the dealiased and superobed output is written by an I/O thread while the next file is processed.
+*/
+class HoofProcessor
+{
+   private:
+      // members
+      mutable std::map<std::string, std::future<std::vector<char>>> _prefetched;  ///< Archived files being read ahead.
+      mutable std::unique_ptr<HoofIOThread> _ioThread;                             ///< Thread writing output files, started on first use.
+
+      // opens an input file, from the read ahead image if there is one
+      HoofH5File _openInput(const std::string& fileName) const;
+      // writes errors to output and closes all open files
+      bool _handleErrors(HoofWorker& worker, HoofH5File& inFile, HoofH5File& outFile,
+         const std::string& fileName, const std::string& site) const;
+      // dealiases and superobs the homogenized data with the kernels in precision T
+      template<typename T> void _dealiasAndSuperob(HoofData& data, HoofH5File& outFile, const std::string& fileName,
+         const std::string& outName, const std::function<void(int)>& mark) const;
+
+   public:
+      // starts reading an archived input file in a background thread
+      void prefetch(const std::string& fileName) const;
+      // processes one file from the input folder, optionally handing its data to the caller
+      bool process(const std::string& fileName, HoofData* result = nullptr) const;
+      // waits until all output files are written and returns the files whose output failed
+      std::vector<std::string> flush() const;
+      // takes the files whose output the I/O thread has written since the last call
+      std::vector<std::string> written() const;
+};
+
+#endif // HOOFPROCESSOR_GUARD
@@ -0,0 +1,372 @@
+/**
+   @file HoofScheduler.cpp
+   @author Peter Smerkol
+   @brief Contains the HoofScheduler class implementation.
+*/
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <optional>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <ctime>
+#include <cctype>
+#include <numeric>
+#include <sys/stat.h>
+#include <HoofTypes.h>
+#include <HoofAux.h>
+#include <HoofSettings.h>
+#include <HoofH5File.h>
+#include <HoofArchive.h>
+#include <HoofMetrics.h>
+#include <HoofScheduler.h>
+
+using std::string;
+using std::vector;
+using std::deque;
+using std::optional;
+using std::cout;
+using std::endl;
+using namespace hoof;
+
+/**
+   @brief Constructor, estimates the cost of every file, orders the files by the scheduling policy,
+      handles stale volumes and assigns each file to the currently least loaded queue.
+   @param fileNames Names of the files in the input folder.
+   @param nQueues Number of queues (workers).
+*/
+HoofScheduler::HoofScheduler(const vector<string>& fileNames, int nQueues) : stolen(0), dropped(0)
+{
+   // estimate the costs and get the arrival and nominal times, a file whose metadata is needed is opened
+   // once for all estimates, so an archived file is read and decompressed only once
+   bool needNominal = HoofSettings::scheduling == "NEWEST" || HoofSettings::maxVolumeAge > 0.0;
+   bool needMetadata = HoofSettings::costEstimate == "METADATA" ||
+      (needNominal && HoofSettings::nominalTime == "METADATA");
+   vector<HoofJob> jobs;
+   for(int i=0; i<fileNames.size(); i++)
+   {
+      optional<HoofH5File> file;
+      if(needMetadata)
+      {
+         try
+         {
+            file = HoofArchive::open(fileNames[i]);
+         }
+         catch(...) {}
+      }
+      HoofH5File* metadata = file ? &file.value() : nullptr;
+      HoofJob job;
+      job.fileName = fileNames[i];
+      job.cost = _estimateCost(fileNames[i], metadata);
+      job.arrival = arrival(fileNames[i]);
+      job.nominal = WallClock::to_time_t(job.arrival);
+      if(needNominal)
+      {
+         optional<std::time_t> nominal = _getNominalTime(fileNames[i], metadata);
+         if(nominal)
+            job.nominal = nominal.value();
+      }
+      if(file)
+         file.value().close();
+      jobs.push_back(job);
+   }
+
+   // order the jobs, keeping the directory order for equal keys
+   if(HoofSettings::scheduling == "LARGEST")
+      std::stable_sort(jobs.begin(), jobs.end(),
+         [](const HoofJob& a, const HoofJob& b) { return a.cost > b.cost; });
+   if(HoofSettings::scheduling == "NEWEST")
+      std::stable_sort(jobs.begin(), jobs.end(),
+         [](const HoofJob& a, const HoofJob& b) { return a.nominal > b.nominal; });
+
+   // drop stale volumes or defer them after all fresh ones
+   if(HoofSettings::maxVolumeAge > 0.0)
+   {
+      std::time_t now = WallClock::to_time_t(WallClock::now());
+      auto isFresh = [&](const HoofJob& job) {
+         return std::difftime(now, job.nominal) <= 60.0*HoofSettings::maxVolumeAge; };
+      auto stale = std::stable_partition(jobs.begin(), jobs.end(), isFresh);
+      if(HoofSettings::staleVolumes == "DROP")
+      {
+         for(auto it=stale; it!=jobs.end(); it++)
+            cout << "Skipping stale volume " << it->fileName << " (" <<
+               (int)(std::difftime(now, it->nominal)/60.0) << " min old)" << endl;
+         dropped = jobs.end() - stale;
+         jobs.erase(stale, jobs.end());
+      }
+   }
+
+   // assign each job to the least loaded queue, each queue stays in the policy order
+   _ordered = HoofSettings::scheduling == "NEWEST" ||
+      (HoofSettings::maxVolumeAge > 0.0 && HoofSettings::staleVolumes == "DEFER");
+   _queues = vector<deque<HoofJob>>(nQueues);
+   _loads = vector<double>(nQueues, 0.0);
+   for(int i=0; i<jobs.size(); i++)
+   {
+      int q = std::min_element(_loads.begin(), _loads.end()) - _loads.begin();
+      jobs[i].rank = i;
+      _queues[q].push_back(jobs[i]);
+      _loads[q] += jobs[i].cost;
+   }
+}
+
+/**
+   @brief Gets the arrival time of a file in the input folder, which is the modification time of the file
+      or of its archive.
+   @param fileName Name of the file in the input folder.
+   @return The arrival time, the current time if the file is not on disk, e.g. an assembled volume.
+*/
+WallTime HoofScheduler::arrival(const string& fileName)
+{
+   struct stat st;
+   if(stat(HoofArchive::diskPath(fileName).c_str(), &st) == 0)
+      return WallTime(std::chrono::seconds(st.st_mtim.tv_sec) + std::chrono::nanoseconds(st.st_mtim.tv_nsec));
+   return WallClock::now();
+}
+
+/**
+   @brief Estimates the cost of processing a file, either from its size or from the number of
+      sweeps, rays and bins in its metadata. Falls back to the size if the metadata can not be read.
+   @param fileName Name of the file in the input folder.
+   @param file The opened file, nullptr if it could not be opened.
+   @return The estimated cost.
+*/
+double HoofScheduler::_estimateCost(const string& fileName, HoofH5File* file) const
+{
+   double size = HoofArchive::size(fileName);
+   if(HoofSettings::costEstimate != "METADATA" || file == nullptr)
+      return size;
+
+   try
+   {
+      vector<string> datasets = file->getDatasets();
+      double bins = 0.0;
+      for(int i=0; i<datasets.size(); i++)
+      {
+         std::optional<int> nrays = file->getAtt<int>(datasets[i] + "/where", "nrays");
+         std::optional<int> nbins = file->getAtt<int>(datasets[i] + "/where", "nbins");
+         if(nrays && nbins)
+            bins += (double)nrays.value() * (double)nbins.value();
+      }
+      if(bins > 0.0)
+         return bins;
+   }
+   catch(...) {}
+   return size;
+}
+
+/**
+   @brief Gets the next job for a worker. Takes the front of the worker's own queue or, if it is empty,
+      steals the front of the most loaded queue. If the policy order holds across the batch, takes the
+      front that comes first in the policy order of all queues instead.
+   @param queue The worker's queue.
+   @return The next job or std::nullopt if all queues are empty.
+*/
+optional<HoofJob> HoofScheduler::next(int queue)
+{
+   int q = queue;
+   bool steal = false;
+   if(_ordered)
+   {
+      q = -1;
+      for(int i=0; i<_queues.size(); i++)
+      {
+         if(!_queues[i].empty() && (q < 0 || _queues[i].front().rank < _queues[q].front().rank))
+            q = i;
+      }
+      if(q < 0)
+         return std::nullopt;
+      steal = q != queue;
+   }
+   else if(_queues[q].empty())
+   {
+      q = -1;
+      for(int i=0; i<_queues.size(); i++)
+      {
+         if(!_queues[i].empty() && (q < 0 || _loads[i] > _loads[q]))
+            q = i;
+      }
+      if(q < 0)
+         return std::nullopt;
+      steal = true;
+   }
+
+   HoofJob job = _queues[q].front();
+   _queues[q].pop_front();
+   if(steal)
+      stolen++;
+   _loads[q] -= job.cost;
+   if(_queues[q].empty())
+      _loads[q] = 0.0;
+
+   // the memory budget is only used by worker processes, the estimate is made when the job is handed out,
+   // so the first files start without a scan of the whole batch
+   if(HoofSettings::workers > 0 && HoofSettings::maxMemory > 0.0)
+      job.memory = _estimateMemory(job.fileName);
+
+   int depth = 0;
+   for(int i=0; i<_queues.size(); i++)
+      depth += _queues[i].size();
+   HoofMetrics::queueDepth(depth);
+   return job;
+}
+
+/**
+   @brief Estimates the peak memory needed to process a file from the dimensions of its DBZ and VRAD
+      sweeps, without reading any data.
+
+   HoofData holds (el, az, r) arrays padded to the largest sweep: DBZ, TH and quality for DBZ and
+   VRAD and heights for VRAD. Dealiasing adds seven double arrays, the Nyquist multipliers and the
+   height sector indexes per VRAD bin, superobing adds rolled copies of the measurements. An output
+   file built in memory is about as large as the input file.
+
+   Archived files and assembled volumes are not opened, that would read and decompress them once more
+   than processing does. Their estimate is archivedMemoryFactor times their uncompressed size, which is
+   above the 20 to 22 times the dimension based estimate gives for OPERA volumes.
+
+   @param fileName Name of the file in the input folder.
+   @return The estimated peak memory in bytes, or 0 if the metadata can not be read.
+*/
+double HoofScheduler::_estimateMemory(const string& fileName) const
+{
+   const double archivedMemoryFactor = 24.0;
+   if(HoofArchive::isArchived(fileName))
+      return archivedMemoryFactor * HoofArchive::size(fileName);
+
+   int nelDbz = 0, nazDbz = 0, nrDbz = 0;
+   int nelVrad = 0, nazVrad = 0, nrVrad = 0;
+   try
+   {
+      HoofH5File file = HoofArchive::open(fileName);
+      vector<string> datasets = file.getDatasets();
+      for(int i=0; i<datasets.size(); i++)
+      {
+         optional<int> nrays = file.getAtt<int>(datasets[i] + "/where", "nrays");
+         optional<int> nbins = file.getAtt<int>(datasets[i] + "/where", "nbins");
+         if(!nrays || !nbins)
+            continue;
+         vector<string> datas = file.getDatas(datasets[i], "data");
+         for(int j=0; j<datas.size(); j++)
+         {
+            optional<string> qty = file.getAtt<string>(datasets[i] + "/" + datas[j] + "/what", "quantity");
+            if(!qty)
+               continue;
+            if(HoofAux::find(qty.value(), HoofSettings::dbzNames))
+            {
+               nelDbz++;
+               nazDbz = std::max(nazDbz, nrays.value());
+               nrDbz = std::max(nrDbz, nbins.value());
+            }
+            if(HoofAux::find(qty.value(), HoofSettings::vradNames))
+            {
+               nelVrad++;
+               nazVrad = std::max(nazVrad, nrays.value());
+               nrVrad = std::max(nrVrad, nbins.value());
+            }
+         }
+      }
+      file.close();
+   }
+   catch(...)
+   {
+      return 0.0;
+   }
+
+   double dbzBins = (double)nelDbz * (double)nazDbz * (double)nrDbz;
+   double vradBins = (double)nelVrad * (double)nazVrad * (double)nrVrad;
+   double d = sizeof(double);
+   double stored = dbzBins * 3.0 * d + vradBins * 2.0 * d;
+   double dealiasing = HoofSettings::dealiasing ?
+      vradBins * (7.0 * d + sizeof(int) + sizeof(Triple)) : 0.0;
+   double superobing = HoofSettings::superobing ? dbzBins * 3.0 * d + vradBins * 2.0 * d : 0.0;
+   double image = HoofSettings::outputInMemory ? HoofArchive::size(fileName) : 0.0;
+   return image + stored + std::max(dealiasing, superobing);
+}
+
+/**
+   @brief Gets the nominal time of a volume, either from the first 12 or 14 digit date in the file name
+      or from the /what/date and /what/time attributes.
+   @param fileName Name of the file in the input folder.
+   @param file The opened file, nullptr if it could not be opened.
+   @return The nominal UTC time or std::nullopt if it can not be determined.
+*/
+optional<std::time_t> HoofScheduler::_getNominalTime(const string& fileName, HoofH5File* file) const
+{
+   string datetime;
+   if(HoofSettings::nominalTime == "METADATA")
+   {
+      try
+      {
+         if(file == nullptr)
+            return std::nullopt;
+         optional<string> date = file->getAtt<string>("/what", "date");
+         optional<string> time = file->getAtt<string>("/what", "time");
+         if(date && time)
+            datetime = date.value() + time.value();
+      }
+      catch(...) {}
+   }
+   else
+   {
+      // find the first run of at least 12 digits (YYYYMMDDhhmm[ss]) in the file name, without the archive name
+      string name = HoofArchive::memberName(fileName);
+      int start = 0;
+      for(int i=0; i<=name.size(); i++)
+      {
+         if(i < name.size() && std::isdigit((unsigned char)name[i]))
+            continue;
+         if(i - start >= 12)
+         {
+            datetime = name.substr(start, i - start >= 14 ? 14 : 12);
+            break;
+         }
+         start = i + 1;
+      }
+   }
+   if(datetime.size() < 12)
+      return std::nullopt;
+
+   return HoofAux::toTime(datetime);
+}
+
+/**
+   @brief Gets the names of the next files in a queue without taking them.
+   @param queue The queue.
+   @param n Maximum number of file names.
+   @return Names of at most n files from the front of the queue.
+*/
+vector<string> HoofScheduler::peek(int queue, int n) const
+{
+   vector<string> fileNames;
+   for(int i=0; i<n && i<_queues[queue].size(); i++)
+      fileNames.push_back(_queues[queue][i].fileName);
+   return fileNames;
+}
+
+/**
+   @brief Records the arrival to output latency of a finished job and prints it.
+   @param job The finished job.
+*/
+void HoofScheduler::finish(const HoofJob& job)
+{
+   double latency = std::chrono::duration<double>(WallClock::now() - job.arrival).count();
+   _latencies.push_back(latency);
+   finished.push_back(job.fileName);
+   cout << "Latency from arrival to output of " << job.fileName << ": " << latency << " s" << endl;
+   HoofMetrics::latency(latency);
+}
+
+/**
+   @brief Prints the mean and maximum arrival to output latency of the batch.
+*/
+void HoofScheduler::printLatency() const
+{
+   if(_latencies.size() == 0)
+      return;
+   double sum = std::accumulate(_latencies.begin(), _latencies.end(), 0.0);
+   double max = *std::max_element(_latencies.begin(), _latencies.end());
+   cout << "Arrival to output latency: mean " << sum/(double)_latencies.size() << " s, max " <<
+      max << " s" << endl;
+}
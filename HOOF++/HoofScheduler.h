@@ -0,0 +1,79 @@
+/**
+   @file HoofScheduler.h
+   @author Peter Smerkol
+   @brief Contains definition of HoofJob struct and HoofScheduler class.
+*/
+
+#ifndef HOOFSCHEDULER_GUARD
+#define HOOFSCHEDULER_GUARD
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <optional>
+#include <ctime>
+#include <HoofTypes.h>
+#include <HoofH5File.h>
+
+/**
+   @struct HoofJob
+   @brief Struct that holds one input file waiting to be processed.
+*/
+struct HoofJob
+{
+   std::string fileName;      ///< Name of the file in the input folder.
+   double cost = 0.0;         ///< Estimated cost of processing the file.
+   double memory = 0.0;       ///< Estimated peak memory in bytes needed to process the file.
+   std::time_t nominal = 0;   ///< Nominal (UTC) time of the volume.
+   hoof::WallTime arrival;    ///< Time when the file arrived in the input folder (its modification time).
+   int rank = 0;              ///< Position of the file in the order of the scheduling policy.
+};
+
+/**
+   @class HoofScheduler
+   @brief Class that orders input files and distributes them into per-worker queues.
+
+   Files are ordered by the namelist scheduling policy and assigned to the least loaded queue. Volumes
+   older than the namelist deadline are dropped or deferred to the end of the batch. A worker
+   takes jobs from the front of its own queue and, when it is empty, steals from the front of the most
+   loaded queue, so the batch ends when the total work is done. With NEWEST scheduling or deferred stale
+   volumes the order matters across the batch, so a worker takes the job that comes first in the policy
+   order from the fronts of all queues, and stale volumes are only started when no fresh one is left.
+*/
+class HoofScheduler
+{
+   private:
+      // members
+      std::vector<std::deque<HoofJob>> _queues;  ///< Per-worker job queues.
+      std::vector<double> _loads;                ///< Remaining estimated cost in each queue.
+      std::vector<double> _latencies;            ///< Arrival to output latencies of finished files in seconds.
+      bool _ordered;                             ///< Jobs are taken in the policy order across all queues.
+
+      // estimates the cost of processing a file
+      double _estimateCost(const std::string& fileName, HoofH5File* file) const;
+      // estimates the peak memory needed to process a file
+      double _estimateMemory(const std::string& fileName) const;
+      // gets the nominal time of a volume from the file name or the file metadata
+      std::optional<std::time_t> _getNominalTime(const std::string& fileName, HoofH5File* file) const;
+
+   public:
+      // members
+      int stolen;                          ///< Number of jobs taken from another worker's queue.
+      int dropped;                         ///< Number of stale volumes that were not scheduled.
+      std::vector<std::string> finished;   ///< Files that were processed successfully.
+
+      // constructor, orders the files and distributes them into queues
+      HoofScheduler(const std::vector<std::string>& fileNames, int nQueues);
+      // gets the arrival time of a file in the input folder
+      static hoof::WallTime arrival(const std::string& fileName);
+      // gets the next job for a worker, or std::nullopt if all work is done
+      std::optional<HoofJob> next(int queue);
+      // gets the names of the next files in a queue without taking them
+      std::vector<std::string> peek(int queue, int n) const;
+      // records and prints the arrival to output latency of a finished job
+      void finish(const HoofJob& job);
+      // prints the latency summary of the batch
+      void printLatency() const;
+};
+
+#endif // HOOFSCHEDULER_GUARD
@@ -15,6 +15,7 @@
 
 using std::string;
 using std::vector;
+using std::map;
 using std::ifstream;
 using std::find;
 using namespace hoof;
@@ -62,6 +63,57 @@ HoofSettings::HoofSettings(const string& _namelist, const string& _inFolder, con
       // fill data according to keywords 
       if(lines[cidx] == "[File extensions to read]")
          fileExtensions = HoofAux::split(lines[cidx+1], "{}");
+      if(lines[cidx] == "[Decompression threads]")
+         decompressionThreads = HoofAux::to<int>(lines[cidx+1]);
+      if(lines[cidx] == "[Scan assembly]")
+         scanAssembly = HoofAux::to<bool>(lines[cidx+1]);
+      if(lines[cidx] == "[Scan timeout in s]")
+         scanTimeout = HoofAux::to<double>(lines[cidx+1]);
+      if(lines[cidx] == "[Expected elevations]")
+      {
+         for(int j=cidx+1; j<nidx; j++)
+         {
+            vector<string> words = HoofAux::split(lines[j]);
+            for(int k=1; k<words.size(); k++)
+               expectedElevations[words[0]].push_back(HoofAux::to<double>(words[k]));
+         }
+      }
+      if(lines[cidx] == "[SWMR input]")
+         swmrInput = HoofAux::to<bool>(lines[cidx+1]);
+      if(lines[cidx] == "[Output archive]")
+         outputArchive = HoofAux::trim(lines[cidx+1]);
+      if(lines[cidx] == "[Output mode]")
+         outputMode = HoofAux::trim(lines[cidx+1]);
+      if(lines[cidx] == "[Output in memory]")
+         outputInMemory = HoofAux::to<bool>(lines[cidx+1]);
+      if(lines[cidx] == "[Write behind]")
+         writeBehind = HoofAux::to<bool>(lines[cidx+1]);
+      if(lines[cidx] == "[Atomic output]")
+         atomicOutput = HoofAux::to<bool>(lines[cidx+1]);
+      if(lines[cidx] == "[Fsync output]")
+         fsyncOutput = HoofAux::to<bool>(lines[cidx+1]);
+      if(lines[cidx] == "[Done markers]")
+         doneMarkers = HoofAux::to<bool>(lines[cidx+1]);
+      if(lines[cidx] == "[Shared memory ring]")
+         sharedMemoryRing = HoofAux::trim(lines[cidx+1]);
+      if(lines[cidx] == "[Shared memory ring size in MB]")
+         sharedMemoryRingSize = HoofAux::to<double>(lines[cidx+1]);
+      if(lines[cidx] == "[Number of worker processes]")
+         workers = HoofAux::to<int>(lines[cidx+1]);
+      if(lines[cidx] == "[Maximum memory in MB]")
+         maxMemory = HoofAux::to<double>(lines[cidx+1]);
+      if(lines[cidx] == "[Quarantine list file]")
+         quarantineList = HoofAux::trim(lines[cidx+1]);
+      if(lines[cidx] == "[Scheduling policy]")
+         scheduling = HoofAux::trim(lines[cidx+1]);
+      if(lines[cidx] == "[Cost estimate]")
+         costEstimate = HoofAux::trim(lines[cidx+1]);
+      if(lines[cidx] == "[Nominal time source]")
+         nominalTime = HoofAux::trim(lines[cidx+1]);
+      if(lines[cidx] == "[Maximum volume age in minutes]")
+         maxVolumeAge = HoofAux::to<double>(lines[cidx+1]);
+      if(lines[cidx] == "[Stale volumes]")
+         staleVolumes = HoofAux::trim(lines[cidx+1]);
       if(lines[cidx] == "[Log keywords]")
       {
          for(int j=cidx+1; j<nidx; j++)
@@ -79,8 +131,20 @@ HoofSettings::HoofSettings(const string& _namelist, const string& _inFolder, con
          printConsoleErrors = HoofAux::to<bool>(lines[cidx+1]);
       if(lines[cidx] == "[Print warnings to log]")
          printLogWarnings = HoofAux::to<bool>(lines[cidx+1]);
+      if(lines[cidx] == "[Log format]")
+         logFormat = HoofAux::trim(lines[cidx+1]);
       if(lines[cidx] == "[Print timing to console]")
          printConsoleTiming = HoofAux::to<bool>(lines[cidx+1]);
+      if(lines[cidx] == "[Hardware counters]")
+         hardwareCounters = HoofAux::to<bool>(lines[cidx+1]);
+      if(lines[cidx] == "[Counters CSV file]")
+         countersFile = HoofAux::trim(lines[cidx+1]);
+      if(lines[cidx] == "[Memory profiling]")
+         memoryProfiling = HoofAux::to<bool>(lines[cidx+1]);
+      if(lines[cidx] == "[HDF5 accounting]")
+         hdf5Accounting = HoofAux::to<bool>(lines[cidx+1]);
+      if(lines[cidx] == "[Metrics file]")
+         metricsFile = HoofAux::trim(lines[cidx+1]);
       if(lines[cidx] == "[Radar moment names to save]")
       {
          for(int j=cidx+1; j<nidx; j++)
@@ -122,12 +186,30 @@ HoofSettings::HoofSettings(const string& _namelist, const string& _inFolder, con
          minGoodPoints = HoofAux::to<int>(lines[cidx+1]);    
       if(lines[cidx] == "[Maximum dealiased wind speed in m/s]")
          maxWind = HoofAux::to<double>(lines[cidx+1]);   
+      if(lines[cidx] == "[Precision]")
+         precision = HoofAux::trim(lines[cidx+1]);
+      if(lines[cidx] == "[Fit sample size]")
+         fitSample = HoofAux::to<int>(lines[cidx+1]);
+      if(lines[cidx] == "[Maximum fit residual in m/s]")
+         maxFitResidual = HoofAux::to<double>(lines[cidx+1]);
+      if(lines[cidx] == "[Warm start dealiasing]")
+         warmStart = HoofAux::to<bool>(lines[cidx+1]);
+      if(lines[cidx] == "[Warm start maximum age in minutes]")
+         warmStartMaxAge = HoofAux::to<double>(lines[cidx+1]);
+      if(lines[cidx] == "[Warm start minimum good points]")
+         warmStartMinPoints = HoofAux::to<int>(lines[cidx+1]);
+      if(lines[cidx] == "[Warm start sample size]")
+         warmStartSample = HoofAux::to<int>(lines[cidx+1]);
+      if(lines[cidx] == "[Warm start weight]")
+         warmStartWeight = HoofAux::to<double>(lines[cidx+1]);
       if(lines[cidx] == "[Superobing]")
          superobing = HoofAux::to<bool>(lines[cidx+1]);
       if(lines[cidx] == "[Range bin factor]")
          rangeBinFactor = HoofAux::to<int>(lines[cidx+1]);
       if(lines[cidx] == "[Ray angle factor]")
          rayAngleFactor = HoofAux::to<int>(lines[cidx+1]);
+      if(lines[cidx] == "[Specialized superob kernels]")
+         specializedSuperob = HoofAux::to<bool>(lines[cidx+1]);
       if(lines[cidx] == "[Max arc size in m]")
          maxArcSize = HoofAux::to<double>(lines[cidx+1]);
       if(lines[cidx] == "[DBZ min quality]")
@@ -148,12 +230,40 @@ string HoofSettings::inFolder = " ";
 string HoofSettings::outFolder = "";
 string HoofSettings::namelist = "";
 vector<string> HoofSettings::fileExtensions;
+int HoofSettings::decompressionThreads = 0;
+bool HoofSettings::scanAssembly = false;
+double HoofSettings::scanTimeout = 300.0;
+map<string, vector<double>> HoofSettings::expectedElevations;
+bool HoofSettings::swmrInput = false;
+string HoofSettings::outputArchive = "NONE";
+string HoofSettings::outputMode = "FULL";
+bool HoofSettings::outputInMemory = false;
+bool HoofSettings::writeBehind = false;
+bool HoofSettings::atomicOutput = false;
+bool HoofSettings::fsyncOutput = false;
+bool HoofSettings::doneMarkers = false;
+string HoofSettings::sharedMemoryRing = "NONE";
+double HoofSettings::sharedMemoryRingSize = 64.0;
+int HoofSettings::workers = 0;
+double HoofSettings::maxMemory = 0.0;
+string HoofSettings::quarantineList = "quarantine.lst";
+string HoofSettings::scheduling = "FILESYSTEM";
+string HoofSettings::costEstimate = "SIZE";
+string HoofSettings::nominalTime = "FILENAME";
+double HoofSettings::maxVolumeAge = 0.0;
+string HoofSettings::staleVolumes = "DEFER";
 string HoofSettings::warningTag = "";
 string HoofSettings::errorTag = "";
 bool HoofSettings::printConsoleWarnings = false;
 bool HoofSettings::printLogWarnings = false;
 bool HoofSettings::printConsoleErrors = false;
+string HoofSettings::logFormat = "TEXT";
 bool HoofSettings::printConsoleTiming = false;
+bool HoofSettings::hardwareCounters = false;
+string HoofSettings::countersFile = "counters.csv";
+bool HoofSettings::memoryProfiling = false;
+bool HoofSettings::hdf5Accounting = false;
+string HoofSettings::metricsFile = "NONE";
 vector<string> HoofSettings::dbzNames;
 vector<string> HoofSettings::thNames;
 vector<string> HoofSettings::vradNames;
@@ -165,9 +275,18 @@ double HoofSettings::zSectorSize = 0.0;
 double HoofSettings::zMax = 0.0;
 int HoofSettings::minGoodPoints = 0;
 double HoofSettings::maxWind = 0.0;
+string HoofSettings::precision = "FLOAT64";
+int HoofSettings::fitSample = 0;
+double HoofSettings::maxFitResidual = 5.0;
+bool HoofSettings::warmStart = false;
+double HoofSettings::warmStartMaxAge = 30.0;
+int HoofSettings::warmStartMinPoints = 100;
+int HoofSettings::warmStartSample = 0;
+double HoofSettings::warmStartWeight = 50.0;
 bool HoofSettings::superobing = false;
 int HoofSettings::rangeBinFactor = 0;
 int HoofSettings::rayAngleFactor = 0;
+bool HoofSettings::specializedSuperob = true;
 double HoofSettings::maxArcSize = 0.0;
 double HoofSettings::minQuality = 0.0;
 double HoofSettings::dbzClearsky = 0.0;
@@ -28,12 +28,40 @@ class HoofSettings
       static std::string outFolder;                   ///< Relative path to folder for output files
       static std::string namelist;                    ///< Name of the namelist file
       static std::vector<std::string> fileExtensions; ///< File extensions representing valid radar files
+      static int decompressionThreads;                ///< Number of archived files decompressed ahead in background threads
+      static bool scanAssembly;                       ///< Flag for assembling volumes from SCAN files with one sweep each
+      static double scanTimeout;                      ///< Seconds after the newest sweep after which an incomplete volume is processed
+      static std::map<std::string, std::vector<double>> expectedElevations;   ///< Elevation angles in degrees of a complete volume, by site
+      static bool swmrInput;                          ///< Flag for reading the complete sweeps of input files still being written in SWMR mode
+      static std::string outputArchive;               ///< Name of the tar archive in the output folder that output files are packed into, NONE for no archive
+      static std::string outputMode;                  ///< How the output file is written (FULL, PLANNED or SUPEROBS)
+      static bool outputInMemory;                     ///< Flag for building output files in memory and writing them at close
+      static bool writeBehind;                        ///< Flag for writing output files in a background I/O thread
+      static bool atomicOutput;                       ///< Flag for writing output files under a temporary name and renaming them at close
+      static bool fsyncOutput;                        ///< Flag for flushing output files to disk before they are renamed
+      static bool doneMarkers;                        ///< Flag for creating a .done marker next to each published output file
+      static std::string sharedMemoryRing;            ///< Name of the shared memory ring for superobs, NONE for no ring
+      static double sharedMemoryRingSize;             ///< Size of the shared memory ring in MB
+      static int workers;                             ///< Number of worker processes, 0 for processing in the main process
+      static double maxMemory;                        ///< Memory budget in MB for files processed at the same time, 0 for no limit
+      static std::string quarantineList;              ///< Name of the list of files that crashed a worker, in the output folder
+      static std::string scheduling;                  ///< Order of processing files (FILESYSTEM, LARGEST or NEWEST)
+      static std::string costEstimate;                ///< How the cost of a file is estimated (SIZE or METADATA)
+      static std::string nominalTime;                 ///< Where the nominal volume time is read from (FILENAME or METADATA)
+      static double maxVolumeAge;                     ///< Maximum age of a volume in minutes, 0 for no deadline
+      static std::string staleVolumes;                ///< What to do with volumes older than the deadline (DROP or DEFER)
       static std::string warningTag;                  ///< Text printed next to warnings, to make them searchable
       static std::string errorTag;                    ///< Text printed next to errors, to make them searchable
       static bool printConsoleWarnings;               ///< Flag for writing warnings to console
       static bool printLogWarnings;                   ///< Flag for writing warnings to log
+      static std::string logFormat;                   ///< Format of the log files, TEXT or JSON lines
       static bool printConsoleErrors;                 ///< Flag for writing errors to console
       static bool printConsoleTiming;                 ///< Flag for writing timing to console
+      static bool hardwareCounters;                   ///< Flag for reading hardware performance counters per stage
+      static std::string countersFile;                ///< Name of the CSV file with the counters, in the output folder
+      static bool memoryProfiling;                    ///< Flag for counting allocations and peak memory per stage
+      static bool hdf5Accounting;                     ///< Flag for counting and timing HDF5 operations per stage
+      static std::string metricsFile;                 ///< Path of the Prometheus metrics file, NONE for no metrics
       static std::vector<std::string> dbzNames;       ///< Radar moment names containing DBZ
       static std::vector<std::string> thNames;        ///< Radar moment names containing TH
       static std::vector<std::string> vradNames;      ///< Radar moment names containing VRAD
@@ -45,9 +73,18 @@ class HoofSettings
       static double zMax;                             ///< Maximum height to dealias
       static int minGoodPoints;                       ///< Minimum number of good points in a sector for wind model
       static double maxWind;                          ///< Maximum wind speed in m/s allowed after dealiasing
+      static std::string precision;                   ///< Floating point type of the dealiasing and superobing calculations (FLOAT64 or FLOAT32)
+      static int fitSample;                           ///< Maximum number of good points in a sector fitted first, 0 for all
+      static double maxFitResidual;                   ///< RMS residual in m/s of a sample fit above which all points are fitted
+      static bool warmStart;                          ///< Flag for starting dealiasing from the wind profile of the previous volume of the site
+      static double warmStartMaxAge;                  ///< Maximum difference in start time in minutes to the volume of the wind profile
+      static int warmStartMinPoints;                  ///< Minimum number of good points in a sector for a wind model fitted with the profile
+      static int warmStartSample;                     ///< Maximum number of good points fitted in a sector with the profile, 0 for all
+      static double warmStartWeight;                  ///< Weight of the profile in a fit in good points
       static bool superobing;                         ///< Flag for superobing
       static int rangeBinFactor;                      ///< Range bin multiplication factor for superobing bins
       static int rayAngleFactor;                      ///< Ray angle multiplication factor for superobing bins
+      static bool specializedSuperob;                 ///< Flag for superob kernels compiled for the range bin and ray angle factors
       static double maxArcSize;                       ///< Maximum allowed arc size in meters for superob bins
       static double minQuality;                       ///< Minimum quality of bin to be accepted in superobing
       static double dbzClearsky;                      ///< DBZ threshold for clear sky
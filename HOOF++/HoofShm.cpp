@@ -0,0 +1,344 @@
+/**
+   @file HoofShm.cpp
+   @author Peter Smerkol
+   @brief Contains the HoofShm class implementation.
+*/
+
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <climits>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <HoofTypes.h>
+#include <HoofShm.h>
+
+using std::string;
+using std::cout;
+using std::endl;
+using namespace hoof;
+
+// --- ring layout
+static const uint32_t magic = 0x464f4f48;   ///< "HOOF" in little endian.
+static const uint32_t version = 1;          ///< Layout version, changed with the Header or Record struct.
+static const size_t headerSize = (sizeof(HoofShm::Header) + 63)/64*64;   ///< Header size rounded to a cache line.
+
+// --- initialize static members
+HoofShm::Header* HoofShm::_header = nullptr;
+char* HoofShm::_records = nullptr;
+
+/**
+   @brief Locks the producer mutex, recovers it if a producer died while holding it.
+   @param mutex The mutex.
+*/
+static void lock(pthread_mutex_t* mutex)
+{
+   if(pthread_mutex_lock(mutex) == EOWNERDEAD)
+      pthread_mutex_consistent(mutex);
+}
+
+/**
+   @brief Maps a shared memory object read-write.
+   @param fd File descriptor of the shared memory object.
+   @param size Bytes to map.
+   @return Start of the mapping, or nullptr on failure.
+*/
+static char* map(int fd, size_t size)
+{
+   void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   return address == MAP_FAILED ? nullptr : (char*)address;
+}
+
+/**
+   @brief Creates the ring or reuses an existing ring with the same size, so attached consumers keep
+      reading across runs. Worker processes inherit the mapping, so it is called before they are forked.
+   @param name Name of the POSIX shared memory object, e.g. /hoof.
+   @param sizeMB Size of the record area in MB.
+   @return True if the ring is mapped.
+*/
+bool HoofShm::start(const string& name, double sizeMB)
+{
+   uint64_t capacity = (uint64_t)(sizeMB*1024.0*1024.0)/8*8;
+   size_t total = headerSize + capacity;
+   int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+   struct stat st;
+   if(fd < 0 || fstat(fd, &st) != 0 || capacity < sizeof(Record))
+   {
+      cout << "Could not open shared memory ring " << name << endl;
+      if(fd >= 0)
+         close(fd);
+      return false;
+   }
+   bool reuse = (size_t)st.st_size == total;
+   if(!reuse && ftruncate(fd, total) != 0)
+   {
+      cout << "Could not resize shared memory ring " << name << endl;
+      close(fd);
+      return false;
+   }
+   char* address = map(fd, total);
+   if(address == nullptr)
+   {
+      cout << "Could not map shared memory ring " << name << endl;
+      return false;
+   }
+
+   Header* header = (Header*)address;
+   if(!reuse || header->magic != magic || header->version != version || header->capacity != capacity)
+   {
+      header->magic = 0;
+      header->version = version;
+      header->capacity = capacity;
+      header->head.store(0);
+      header->reserved.store(0);
+      header->sequence.store(0);
+      header->waiters.store(0);
+      pthread_mutexattr_t attributes;
+      pthread_mutexattr_init(&attributes);
+      pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+      pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+      pthread_mutex_init(&header->mutex, &attributes);
+      pthread_mutexattr_destroy(&attributes);
+      std::atomic_thread_fence(std::memory_order_release);
+      header->magic = magic;
+   }
+   _header = header;
+   _records = address + headerSize;
+   return true;
+}
+
+/**
+   @brief Reserves space for the next record while the mutex is held. If the record does not fit
+      before the end of the ring, the rest of the ring is skipped with a padding record.
+   @param size Bytes of the record.
+   @return The record in the ring.
+*/
+HoofShm::Record* HoofShm::_reserve(uint64_t size)
+{
+   uint64_t capacity = _header->capacity;
+   uint64_t head = _header->head.load(std::memory_order_relaxed);
+   uint64_t rest = capacity - head%capacity;
+   uint64_t skip = rest < size ? rest : 0;
+
+   // consumers detect overwritten records from reserved, so it is advanced before writing
+   _header->reserved.store(head + skip + size, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_release);
+   if(skip >= sizeof(Record))
+   {
+      Record* padding = (Record*)(_records + head%capacity);
+      padding->size = skip;
+      padding->sequence = 0;
+      padding->quantity[0] = '\0';
+   }
+   return (Record*)(_records + (head + skip)%capacity);
+}
+
+/**
+   @brief Publishes one superobed measurement as one record.
+   @param fileName Name of the input file.
+   @param site Radar site.
+   @param quantity DBZ or VRAD.
+   @param m The superobed measurement.
+*/
+void HoofShm::_publish(const string& fileName, const string& site, const char* quantity, const HoofMeasurement& m)
+{
+   int64_t nel = m.meas.size();
+   int64_t naz = 0;
+   int64_t nr = 0;
+   for(const auto& el : m.meas)
+   {
+      naz = std::max(naz, (int64_t)el.size());
+      for(const auto& az : el)
+         nr = std::max(nr, (int64_t)az.size());
+   }
+   uint64_t size = sizeof(Record) + sizeof(double)*(nel + nel*naz + nel*nr + 2*nel*naz*nr);
+   if(size > _header->capacity)
+   {
+      cout << "Superobs of " << fileName << " do not fit into the shared memory ring" << endl;
+      return;
+   }
+
+   lock(&_header->mutex);
+   Record* record = _reserve(size);
+   record->size = size;
+   record->sequence = _header->sequence.load(std::memory_order_relaxed) + 1;
+   snprintf(record->file, sizeof(record->file), "%s", fileName.c_str());
+   snprintf(record->site, sizeof(record->site), "%s", site.c_str());
+   snprintf(record->quantity, sizeof(record->quantity), "%s", quantity);
+   record->nel = nel;
+   record->naz = naz;
+   record->nr = nr;
+   record->unused = 0;
+
+   // copy the arrays, shorter elevations are padded with NaN
+   double* elangles = (double*)(record + 1);
+   double* azimuths = elangles + nel;
+   double* ranges = azimuths + nel*naz;
+   double* values = ranges + nel*nr;
+   double* quality = values + nel*naz*nr;
+   std::fill(elangles, quality + nel*naz*nr, dNaN);
+   for(int64_t i=0; i<nel; i++)
+   {
+      if(i < (int64_t)m.elangles.size())
+         elangles[i] = m.elangles[i];
+      if(i < (int64_t)m.azimuths.size())
+         std::copy(m.azimuths[i].begin(), m.azimuths[i].begin() + std::min(naz, (int64_t)m.azimuths[i].size()),
+            azimuths + i*naz);
+      if(i < (int64_t)m.ranges.size())
+         std::copy(m.ranges[i].begin(), m.ranges[i].begin() + std::min(nr, (int64_t)m.ranges[i].size()),
+            ranges + i*nr);
+      for(int64_t j=0; j<(int64_t)m.meas[i].size(); j++)
+      {
+         std::copy(m.meas[i][j].begin(), m.meas[i][j].end(), values + (i*naz + j)*nr);
+         if(i < (int64_t)m.quals.size() && j < (int64_t)m.quals[i].size())
+            std::copy(m.quals[i][j].begin(), m.quals[i][j].end(), quality + (i*naz + j)*nr);
+      }
+   }
+   timespec now;
+   clock_gettime(CLOCK_REALTIME, &now);
+   record->published = (int64_t)now.tv_sec*1000000000 + now.tv_nsec;
+
+   // make the record visible and wake the consumers, the futex is only called if one is waiting
+   _header->head.store(_header->reserved.load(std::memory_order_relaxed), std::memory_order_release);
+   _header->sequence.fetch_add(1, std::memory_order_release);
+   pthread_mutex_unlock(&_header->mutex);
+   if(_header->waiters.load(std::memory_order_acquire) > 0)
+      syscall(SYS_futex, (uint32_t*)&_header->sequence, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+/**
+   @brief Publishes the superobed DBZ and VRAD of a file, measurements without superobs are skipped.
+   @param fileName Name of the input file.
+   @param data Data of the file after superobing.
+*/
+void HoofShm::publish(const string& fileName, const HoofData& data)
+{
+   if(!enabled())
+      return;
+   if(!data.sdbz.meas.empty())
+      _publish(fileName, data.site, "DBZ", data.sdbz);
+   if(!data.svrad.meas.empty())
+      _publish(fileName, data.site, "VRAD", data.svrad);
+}
+
+/**
+   @brief Unmaps the ring.
+*/
+HoofShm::Reader::~Reader()
+{
+   if(_header != nullptr)
+      munmap(_header, _mapped);
+}
+
+/**
+   @brief Maps an existing ring. Records published before attaching are not read.
+   @param name Name of the POSIX shared memory object.
+   @return True if the ring is mapped.
+*/
+bool HoofShm::Reader::attach(const string& name)
+{
+   int fd = shm_open(name.c_str(), O_RDWR, 0);
+   struct stat st;
+   if(fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size <= headerSize)
+   {
+      if(fd >= 0)
+         close(fd);
+      return false;
+   }
+   char* address = map(fd, st.st_size);
+   if(address == nullptr)
+      return false;
+   Header* header = (Header*)address;
+   if(header->magic != magic || header->version != version || header->capacity != st.st_size - headerSize)
+   {
+      munmap(address, st.st_size);
+      return false;
+   }
+   _header = header;
+   _records = address + headerSize;
+   _mapped = st.st_size;
+   _position = _header->head.load(std::memory_order_acquire);
+   return true;
+}
+
+/**
+   @brief Waits for the next record and returns it in place. The record stays in the ring until the
+      producer wraps around, check valid() after reading it.
+   @param timeout Maximum time to wait in milliseconds.
+   @return The record, or nullptr if none was published in time.
+*/
+const HoofShm::Record* HoofShm::Reader::next(int timeout)
+{
+   uint64_t capacity = _header->capacity;
+   bool waited = false;
+   while(true)
+   {
+      uint32_t sequence = _header->sequence.load(std::memory_order_acquire);
+      uint64_t head = _header->head.load(std::memory_order_acquire);
+
+      // wait on the futex, it returns at once if a record was published after reading the sequence
+      if(_position == head)
+      {
+         if(waited)
+            return nullptr;
+         timespec wait = {timeout/1000, (timeout%1000)*1000000L};
+         _header->waiters.fetch_add(1, std::memory_order_acq_rel);
+         if(_header->sequence.load(std::memory_order_acquire) == sequence)
+            syscall(SYS_futex, (uint32_t*)&_header->sequence, FUTEX_WAIT, sequence, &wait, nullptr, 0);
+         _header->waiters.fetch_sub(1, std::memory_order_acq_rel);
+         waited = true;
+         continue;
+      }
+
+      // fell behind by more than the ring, continue with the newest records
+      if(head - _position > capacity)
+      {
+         _position = head;
+         continue;
+      }
+
+      // the rest of the ring is too short for a record header
+      uint64_t rest = capacity - _position%capacity;
+      if(rest < sizeof(Record))
+      {
+         _position += rest;
+         continue;
+      }
+
+      const Record* record = (const Record*)(_records + _position%capacity);
+      uint64_t size = record->size;
+      uint64_t number = record->sequence;
+      bool padding = record->quantity[0] == '\0';
+      _current = _position;
+      if(!valid())
+      {
+         _position = _header->head.load(std::memory_order_acquire);
+         continue;
+      }
+      _position += size;
+      if(padding)
+         continue;
+      if(_sequence != 0 && number > _sequence + 1)
+         _lost += number - _sequence - 1;
+      _sequence = number;
+      return record;
+   }
+}
+
+/**
+   @brief Checks that the producer did not start overwriting the record returned by next.
+   @return True if everything read from the record so far is valid.
+*/
+bool HoofShm::Reader::valid() const
+{
+   std::atomic_thread_fence(std::memory_order_acquire);
+   return _header->reserved.load(std::memory_order_relaxed) <= _current + _header->capacity;
+}
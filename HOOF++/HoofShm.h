@@ -0,0 +1,120 @@
+/**
+   @file HoofShm.h
+   @author Peter Smerkol
+   @brief Contains definition of HoofShm class.
+*/
+
+#ifndef HOOFSHM_GUARD
+#define HOOFSHM_GUARD
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <pthread.h>
+#include <HoofData.h>
+
+/**
+   @class HoofShm
+   @brief Class that publishes the superobs of each file to a POSIX shared memory ring.
+
+   The ring is a header followed by a byte area of records. Each record holds the superobs of one
+   quantity of one file with a header and its arrays, so a consumer on the same node reads them in place
+   as soon as they are published instead of polling the output folder. Producers (the main process or the
+   worker processes, which inherit the mapping) take a process-shared mutex, reserve space, copy the record
+   and advance the head. Consumers are woken with a futex on the sequence number. The producer never waits
+   for consumers: a consumer that falls behind by more than the ring size loses records and sees the gap
+   in the sequence numbers, and a record that is overwritten while it is read is detected with valid().
+   hoofshm.cpp is a reference consumer and hoofshmbench.cpp measures the latency.
+*/
+class HoofShm
+{
+   public:
+      /**
+         @struct Header
+         @brief Header at the start of the shared memory.
+      */
+      struct Header
+      {
+         uint32_t magic;                   ///< Marks an initialized ring.
+         uint32_t version;                 ///< Layout version of the ring.
+         uint64_t capacity;                ///< Size of the record area in bytes.
+         std::atomic<uint64_t> head;       ///< Bytes published since the ring was created.
+         std::atomic<uint64_t> reserved;   ///< Bytes published or being written, overwritten records end below it.
+         std::atomic<uint32_t> sequence;   ///< Number of published records, futex word of the consumers.
+         std::atomic<uint32_t> waiters;    ///< Number of consumers waiting on the futex.
+         pthread_mutex_t mutex;            ///< Serializes producers in different processes.
+      };
+
+      /**
+         @struct Record
+         @brief Header of one record, followed by the arrays elangles (nel), azimuths (nel, naz),
+            ranges (nel, nr), values (nel, naz, nr) and quality (nel, naz, nr) in C order, padded with NaN.
+      */
+      struct Record
+      {
+         uint64_t size;       ///< Bytes of the record with its arrays.
+         uint64_t sequence;   ///< Sequence number of the record.
+         int64_t published;   ///< Time of publishing in nanoseconds since the epoch.
+         char file[128];      ///< Input file name.
+         char site[8];        ///< Radar site.
+         char quantity[8];    ///< DBZ or VRAD, empty for padding at the end of the ring.
+         int32_t nel;         ///< Number of elevations.
+         int32_t naz;         ///< Maximum number of azimuths.
+         int32_t nr;          ///< Maximum number of range bins.
+         int32_t unused;      ///< Keeps the arrays aligned.
+
+         // arrays that follow the record header
+         const double* elangles() const { return (const double*)(this + 1); }
+         const double* azimuths() const { return elangles() + nel; }
+         const double* ranges() const { return azimuths() + (int64_t)nel*naz; }
+         const double* values() const { return ranges() + (int64_t)nel*nr; }
+         const double* quality() const { return values() + (int64_t)nel*naz*nr; }
+      };
+
+      /**
+         @class Reader
+         @brief Consumer of a ring that reads records in place.
+      */
+      class Reader
+      {
+         public:
+            ~Reader();
+            // maps an existing ring, the first record read is the next one published
+            bool attach(const std::string& name);
+            // waits up to timeout ms for the next record and returns it, nullptr on timeout
+            const Record* next(int timeout);
+            // checks that the last record returned by next was not overwritten while it was read
+            bool valid() const;
+            // returns the number of records lost because the reader fell behind
+            uint64_t lost() const { return _lost; }
+
+         private:
+            Header* _header = nullptr;       ///< Header of the mapped ring.
+            char* _records = nullptr;        ///< Record area of the mapped ring.
+            size_t _mapped = 0;              ///< Mapped bytes.
+            uint64_t _position = 0;          ///< Position of the next record.
+            uint64_t _current = 0;           ///< Position of the record returned by next.
+            uint64_t _sequence = 0;          ///< Sequence number of the record returned by next.
+            uint64_t _lost = 0;              ///< Number of lost records.
+      };
+
+      // creates or reuses the ring and maps it, called before worker processes are forked
+      static bool start(const std::string& name, double sizeMB);
+      // checks if a ring is mapped
+      static bool enabled() { return _header != nullptr; }
+      // publishes the superobed DBZ and VRAD of a file
+      static void publish(const std::string& fileName, const HoofData& data);
+
+   private:
+      // members
+      static Header* _header;     ///< Header of the mapped ring.
+      static char* _records;      ///< Record area of the mapped ring.
+
+      // publishes one superobed measurement
+      static void _publish(const std::string& fileName, const std::string& site, const char* quantity,
+         const HoofMeasurement& m);
+      // reserves the next record of a given size while the mutex is held, writes padding at the end of the ring
+      static Record* _reserve(uint64_t size);
+};
+
+#endif // HOOFSHM_GUARD
@@ -8,6 +8,8 @@
 #include <vector>
 #include <algorithm>
 #include <cmath>
+#include <map>
+#include <utility>
 #include <iostream>
 #include <HoofTypes.h>
 #include <HoofAux.h>
@@ -32,7 +34,8 @@ using namespace hoof;
    @param data A HoofData object to fill to be used later in dealiasing and superobing.
    @param outFile The output file.
 */
-HoofSuperober::HoofSuperober(HoofData& data, HoofH5File& outFile) :
+template<typename T>
+HoofSuperober<T>::HoofSuperober(HoofData& data, HoofH5File& outFile) :
    _outFile(outFile), _data(data), _dbzsNaN(false), _vradsNaN(false)
 {
    classMessage = "Superobing";
@@ -45,7 +48,8 @@ HoofSuperober::HoofSuperober(HoofData& data, HoofH5File& outFile) :
 
    @param type "DBZ" or "VRAD".
  */
-void HoofSuperober::_calculateBinBorders(const string& type)
+template<typename T>
+void HoofSuperober<T>::_calculateBinBorders(const string& type)
 {
    // short aliases
    int binF = HoofSettings::rangeBinFactor;
@@ -148,11 +152,12 @@ void HoofSuperober::_calculateBinBorders(const string& type)
 /**
   @brief Checks if data is ok for superobing.
 */
-void HoofSuperober::checkData()
+template<typename T>
+void HoofSuperober<T>::checkData()
 {
    if(_data.dbz.nel == 0 && _data.vrad.nel == 0)
    {
-         error("no data to superob");
+         error("NO_DATA", "no data to superob");
          return;
    }
 
@@ -162,19 +167,20 @@ void HoofSuperober::checkData()
       _vradsNaN = true;      
    if(_dbzsNaN && _vradsNaN)
    {
-      error("all data is NaN");
+      error("ALL_NAN", "all data is NaN");
    }
 
    if(_dbzsNaN && !_vradsNaN)
-      warning("all DBZ data is NaN");
+      warning("DBZ_ALL_NAN", "all DBZ data is NaN");
    if(!_dbzsNaN && _vradsNaN)
-      warning("all VRAD data is NaN");  
+      warning("VRAD_ALL_NAN", "all VRAD data is NaN");  
 }
 
 /**
    @brief Prepares the superobed metadata.
 */
-void HoofSuperober::prepareMetadata()
+template<typename T>
+void HoofSuperober<T>::prepareMetadata()
 {
    // short aliases
    int binF = HoofSettings::rangeBinFactor;
@@ -246,17 +252,256 @@ void HoofSuperober::prepareMetadata()
 }
 
 /**
-   @brief Superobs the data.
+   @brief Adds one ray of a DBZ superob box to its counts and sums. With a Bins above 0 the number of
+      bins is known at compile time and the loop is unrolled. Points are added without branches, points
+      that do not count add 0, so the sums are the same as when they are skipped.
+   @param d DBZ values of the ray from the first bin of the box.
+   @param t TH values of the ray from the first bin of the box.
+   @param q Quality values of the ray from the first bin of the box.
+   @param bins Number of bins of the box, used if Bins is 0.
+   @param clearth Clear sky threshold.
+   @param qualth Minimum quality.
+   @param nWet Number of wet points.
+   @param nDry Number of dry points.
+   @param wetAvg Sum of the wet points.
+   @param nWetTh Number of wet points with TH.
+   @param wetAvgTh Sum of TH of the wet points.
 */
-void HoofSuperober::superob()
+template<int Bins, typename T>
+static inline void dbzRay(const T* d, const T* t, const T* q, int bins, T clearth, T qualth,
+   int& nWet, int& nDry, T& wetAvg, int& nWetTh, T& wetAvgTh)
+{
+   auto add = [&](int m)
+   {
+      int good = q[m] > qualth;
+      int wet = good & (d[m] > clearth);
+      int wetTh = wet & (t[m] < (T)100000.0);
+      nWet += wet;
+      nDry += good - wet;
+      wetAvg = wetAvg + (wet ? d[m] : (T)0.0);
+      nWetTh += wetTh;
+      wetAvgTh = wetAvgTh + (wetTh ? t[m] : (T)0.0);
+   };
+   if constexpr(Bins > 0)
+   {
+      #pragma GCC unroll 16
+      for(int m=0; m<Bins; m++)
+         add(m);
+   }
+   else
+   {
+      for(int m=0; m<bins; m++)
+         add(m);
+   }
+}
+
+/**
+   @brief Adds one ray of a VRAD superob box to its counts and sums, without branches like dbzRay.
+   @param v VRAD values of the ray from the first bin of the box.
+   @param startBin Index of the first bin of the box.
+   @param bins Number of bins of the box, used if Bins is 0.
+   @param nGood Number of good points.
+   @param s Sum for the average.
+   @param s2 Sum of squares for the standard deviation.
+*/
+template<int Bins, typename T>
+static inline void vradRay(const T* v, int startBin, int bins, int& nGood, T& s, T& s2)
+{
+   auto add = [&](int m)
+   {
+      int good = v[m] < (T)1000000.0;
+      int bin = startBin + m;
+      nGood += good;
+      s = s + (good ? bin : 0);
+      s2 = s2 + (good ? bin*bin : 0);
+   };
+   if constexpr(Bins > 0)
+   {
+      #pragma GCC unroll 16
+      for(int m=0; m<Bins; m++)
+         add(m);
+   }
+   else
+   {
+      for(int m=0; m<bins; m++)
+         add(m);
+   }
+}
+
+/**
+   @brief Calls a superob kernel for all superobs of an elevation. The generic kernels go through the
+      rays for each range bin. Kernels compiled for a [Ray angle factor] go along each ray instead, so
+      the boxes of consecutive calls are next to each other in the rolled arrays and in the superobs.
+   @param nsr Number of superobed range bins.
+   @param nsaz Number of superobed rays.
+   @param box Makes the superob of range bin j and ray k.
+*/
+template<int RayF, typename F>
+static inline void forBoxes(int nsr, int nsaz, F& box)
+{
+   if constexpr(RayF > 0)
+   {
+      for(int k=0; k<nsaz; k++)
+      {
+         for(int j=0; j<nsr; j++)
+            box(j, k);
+      }
+   }
+   else
+   {
+      for(int j=0; j<nsr; j++)
+      {
+         for(int k=0; k<nsaz; k++)
+            box(j, k);
+      }
+   }
+}
+
+/**
+   @brief Makes the DBZ superobs of one elevation. BinF and RayF above 0 are the [Range bin factor] and
+      [Ray angle factor] the kernel is compiled for, boxes of RayF rays are then reduced with both loops
+      of fixed length. With 0 they are taken from the settings.
+   @param i Index of the elevation.
+   @param meas DBZ values rolled by zmax rays.
+   @param ths TH values rolled by zmax rays.
+   @param quals Quality values rolled by zmax rays.
+   @param dbzmin Smallest DBZ of the volume, given to dry superobs.
+*/
+template<typename T>
+template<int BinF, int RayF>
+void HoofSuperober<T>::_superobDbz(int i, const vector3D<T>& meas, const vector3D<T>& ths,
+   const vector3D<T>& quals, double dbzmin)
 {
    // short aliases
-   double arcmax = HoofSettings::maxArcSize;
-   double clearth = HoofSettings::dbzClearsky;
-   double qualth = HoofSettings::minQuality;
+   T clearth = HoofSettings::dbzClearsky;
+   T qualth = HoofSettings::minQuality;
    double dbzgood = HoofSettings::dbzPercentage;
+   int binF = BinF > 0 ? BinF : HoofSettings::rangeBinFactor;
+   int nsaz = _data.sdbz.naz[i];
+   int nsr = _data.sdbz.nr[i];
+
+   // make the superob of range bin j and ray k
+   auto box = [&](int j, int k)
+   {
+      int startBin = _rangeBorders[i][j];
+      int endBin = _rangeBorders[i][j+1];
+      int startRay = _startRayBorders[i][j][k];
+      int endRay = _endRayBorders[i][j][k];
+
+      // count the wet and dry points and calculate average of wet points
+      int nWet = 0;
+      int nDry = 0;
+      T wetAvg = 0.0;
+      int nWetTh = 0;
+      T wetAvgTh = 0.0;
+      if(RayF > 0 && endRay - startRay == RayF)
+      {
+         #pragma GCC unroll 4
+         for(int l=0; l<RayF; l++)
+            dbzRay<BinF>(&meas[i][startRay+l][startBin], &ths[i][startRay+l][startBin],
+               &quals[i][startRay+l][startBin], binF, clearth, qualth, nWet, nDry, wetAvg, nWetTh, wetAvgTh);
+      }
+      else
+      {
+         for(int l=startRay; l<endRay; l++)
+            dbzRay<BinF>(&meas[i][l][startBin], &ths[i][l][startBin], &quals[i][l][startBin], endBin-startBin,
+               clearth, qualth, nWet, nDry, wetAvg, nWetTh, wetAvgTh);
+      }
+
+      // calculate and store the superob
+      if(nWet > dbzgood * (double)((endRay-startRay)*(endBin-startBin)))
+      {
+         _data.sdbz.meas[i][k][j] = wetAvg/(T)nWet;
+         if(nWetTh > 0)
+            _data.sdbz.ths[i][k][j] = wetAvgTh/(T)nWetTh;
+         _data.sdbz.quals[i][k][j] = 1.0;
+      }
+      else
+      {
+         if(nDry > 0)
+         {
+            _data.sdbz.meas[i][k][j] = dbzmin;
+            _data.sdbz.quals[i][k][j] = 1.0;
+         }
+      }
+   };
+   forBoxes<RayF>(nsr, nsaz, box);
+}
+
+/**
+   @brief Makes the VRAD superobs of one elevation, compiled for BinF and RayF like _superobDbz.
+   @param i Index of the elevation.
+   @param meas VRAD values rolled by zmax rays.
+*/
+template<typename T>
+template<int BinF, int RayF>
+void HoofSuperober<T>::_superobVrad(int i, const vector3D<T>& meas)
+{
+   // short aliases
    double vradgood = HoofSettings::vradPercentage;
-   double maxstd = HoofSettings::vradMaxStd;
+   T maxstd = HoofSettings::vradMaxStd;
+   int binF = BinF > 0 ? BinF : HoofSettings::rangeBinFactor;
+   int nsaz = _data.svrad.naz[i];
+   int nsr = _data.svrad.nr[i];
+
+   // make the superob of range bin j and ray k
+   auto box = [&](int j, int k)
+   {
+      int startBin = _rangeBorders[i][j];
+      int endBin = _rangeBorders[i][j+1];
+      int startRay = _startRayBorders[i][j][k];
+      int endRay = _endRayBorders[i][j][k];
+
+      // count the good points and calculate average and standard deviation
+      int nGood = 0;
+      T s = 0.0;
+      T s2 = 0.0;
+      T avg = 0.0;
+      T std = maxstd + (T)1.0;
+      if(RayF > 0 && endRay - startRay == RayF)
+      {
+         #pragma GCC unroll 4
+         for(int l=0; l<RayF; l++)
+            vradRay<BinF>(&meas[i][startRay+l][startBin], startBin, binF, nGood, s, s2);
+      }
+      else
+      {
+         for(int l=startRay; l<endRay; l++)
+            vradRay<BinF>(&meas[i][l][startBin], startBin, endBin-startBin, nGood, s, s2);
+      }
+      if(nGood > 0)
+      {
+         avg = s / (T)nGood;
+         T std2 = (s2 - s*avg)/(T)nGood;
+         std = std2 > (T)0.0 ? sqrt(std2) : (T)0.0;
+      }
+
+      // calculate and store the superob
+      if(nGood > vradgood*(double)((endRay-startRay)*(endBin-startBin)) && std < maxstd)
+      {
+         _data.svrad.meas[i][k][j] = avg;
+         _data.svrad.quals[i][k][j] = 1.0;
+      }
+   };
+   forBoxes<RayF>(nsr, nsaz, box);
+}
+
+// --- superob kernels compiled for the range bin and ray angle factors used in production
+template<typename T>
+const std::map<std::pair<int, int>, typename HoofSuperober<T>::Kernels> HoofSuperober<T>::_kernels = {
+   {{5, 1}, {&HoofSuperober<T>::_superobDbz<5, 1>, &HoofSuperober<T>::_superobVrad<5, 1>}},
+   {{3, 3}, {&HoofSuperober<T>::_superobDbz<3, 3>, &HoofSuperober<T>::_superobVrad<3, 3>}},
+   {{10, 1}, {&HoofSuperober<T>::_superobDbz<10, 1>, &HoofSuperober<T>::_superobVrad<10, 1>}}
+};
+
+/**
+   @brief Superobs the data. With [Specialized superob kernels], the kernels compiled for the [Range bin
+      factor] and [Ray angle factor] are used if there are any, otherwise the generic ones.
+*/
+template<typename T>
+void HoofSuperober<T>::superob()
+{
+   // short aliases
    double dbzmin = HoofAux::nanminmax(_data.dbz.meas)[0];
    int binF = HoofSettings::rangeBinFactor;
    int rayF = HoofSettings::rayAngleFactor;
@@ -274,6 +519,12 @@ void HoofSuperober::superob()
    int Nsazv = _data.svrad.nazMax;
    int Nsrv = _data.svrad.nrMax;       
 
+   // choose the kernels for the factors
+   Kernels kernels = {&HoofSuperober<T>::_superobDbz<0, 0>, &HoofSuperober<T>::_superobVrad<0, 0>};
+   auto it = _kernels.find({binF, rayF});
+   if(HoofSettings::specializedSuperob && it != _kernels.end())
+      kernels = it->second;
+
    // superob DBZ measurements
    if(Nel > 0)
    {
@@ -286,9 +537,9 @@ void HoofSuperober::superob()
       _data.sdbz.quals = vector3D<double>(Nsel, vector2D<double>(Nsaz, vector<double>(Nsr, dNaN)));
 
       // roll the original arrays by zmax to get the correct ray positions
-      vector3D<double> meas = vector3D<double>(Nel, vector2D<double>(Naz, vector<double>(Nr, dNaN)));
-      vector3D<double> ths = vector3D<double>(Nel, vector2D<double>(Naz, vector<double>(Nr, dNaN)));
-      vector3D<double> quals = vector3D<double>(Nel, vector2D<double>(Naz, vector<double>(Nr, 0.0)));
+      vector3D<T> meas = vector3D<T>(Nel, vector2D<T>(Naz, vector<T>(Nr, (T)dNaN)));
+      vector3D<T> ths = vector3D<T>(Nel, vector2D<T>(Naz, vector<T>(Nr, (T)dNaN)));
+      vector3D<T> quals = vector3D<T>(Nel, vector2D<T>(Naz, vector<T>(Nr, (T)0.0)));
       for(int i=0; i<Nel; i++)
       {
          for(int j=0; j<Naz; j++)
@@ -305,74 +556,7 @@ void HoofSuperober::superob()
 
       // loop on superobed elevations
       for(int i=0; i<Nsel; i++)
-      {
-         // short aliases
-         int naz = _data.dbz.naz[i];
-         int nr = _data.dbz.nr[i];         
-         int nsaz = _data.sdbz.naz[i];
-         int nsr = _data.sdbz.nr[i];
-
-         // make superobs
-         for(int j=0; j<nsr; j++)
-         {
-            int startBin = _rangeBorders[i][j];
-            int endBin = _rangeBorders[i][j+1];
-            for(int k=0; k<nsaz; k++)
-            {
-               int startRay = _startRayBorders[i][j][k];
-               int endRay = _endRayBorders[i][j][k];
-
-               // count the wet and dry points and calculate average of wet points
-               int nWet = 0;
-               int nDry = 0;
-               double wetAvg = 0.0;
-               int nWetTh = 0;
-               double wetAvgTh = 0.0;
-               for(int l=startRay; l<endRay; l++)
-               {
-                  for(int m=startBin; m<endBin; m++)
-                  {
-                     double d = meas[i][l][m];
-                     double t = ths[i][l][m];
-                     double q = quals[i][l][m];
-                     if(q > qualth)
-                     {
-                        if(d > clearth)
-                        {
-                           nWet++;
-                           wetAvg = wetAvg + d;
-                           if(t < 100000.0)
-                           {
-                              nWetTh++;
-                              wetAvgTh = wetAvgTh + t;
-                           }
-                        }
-                        else
-                           nDry++;
-                     }
-                  }
-               }
-
-               // calculate and store the superob
-               if(nWet > dbzgood * (double)((endRay-startRay)*(endBin-startBin)))
-               {
-                  _data.sdbz.meas[i][k][j] = wetAvg/(double)nWet;
-                  if(nWetTh > 0)
-                     _data.sdbz.ths[i][k][j] = wetAvgTh/(double)nWetTh;
-                  _data.sdbz.quals[i][k][j] = 1.0;
-               }
-               else
-               {
-                  if(nDry > 0)
-                  {
-                     _data.sdbz.meas[i][k][j] = dbzmin;
-                     _data.sdbz.quals[i][k][j] = 1.0;
-                  }
-               }
-
-            }
-         }
-      }
+         (this->*kernels.dbz)(i, meas, ths, quals, dbzmin);
    }
 
    // superob VRAD measurements
@@ -386,12 +570,8 @@ void HoofSuperober::superob()
       _data.svrad.quals = vector3D<double>(Nselv, vector2D<double>(Nsazv, vector<double>(Nsrv, 0.0)));
 
       // roll the original array by zmax to get the correct ray positions
-      vector3D<double> meas = vector3D<double>(Nelv, vector2D<double>(Nazv, vector<double>(Nrv, dNaN)));
-      vector3D<double> oldmeas;
-      if(HoofSettings::dealiasing)
-         oldmeas = _data.dvrads;
-      else
-         oldmeas = _data.vrad.meas;
+      vector3D<T> meas = vector3D<T>(Nelv, vector2D<T>(Nazv, vector<T>(Nrv, (T)dNaN)));
+      const vector3D<double>& oldmeas = HoofSettings::dealiasing ? _data.dvrads : _data.vrad.meas;
       for(int i=0; i<Nelv; i++)
       {
          for(int j=0; j<Nazv; j++)
@@ -404,67 +584,15 @@ void HoofSuperober::superob()
 
       // loop on superobed elevations
       for(int i=0; i<Nselv; i++)
-      {
-         // short aliases
-         int naz = _data.vrad.naz[i];
-         int nr = _data.vrad.nr[i];         
-         int nsaz = _data.svrad.naz[i];
-         int nsr = _data.svrad.nr[i];
-
-         // make superobs
-         for(int j=0; j<nsr; j++)
-         {
-            int startBin = _rangeBorders[i][j];
-            int endBin = _rangeBorders[i][j+1];
-            for(int k=0; k<nsaz; k++)
-            {
-               int startRay = _startRayBorders[i][j][k];
-               int endRay = _endRayBorders[i][j][k];         
-            
-
-               // count the good points and calculate average and standard deviation
-               int nGood = 0;
-               double s = 0.0;
-               double s2 = 0.0;
-               double avg = 0.0;
-               double std = maxstd + 1.0;
-               for(int l=startRay; l<endRay; l++)
-               {
-                  for(int m=startBin; m<endBin; m++)
-                  {
-                     double v = meas[i][l][m];
-                     if(v < 1000000.0)
-                     {
-                        nGood++;
-                        s = s + m;
-                        s2 = s2 + m*m;
-                     }
-
-                  }
-               }
-               if(nGood > 0)
-               {
-                  avg = s / (double)nGood;
-                  double std2 = (s2 - s*avg)/(double)nGood;
-                  std = std2 > 0.0 ? sqrt(std2) : 0.0;
-               }
-
-               // calculate and store the superob
-               if(nGood > vradgood*(double)((endRay-startRay)*(endBin-startBin)) && std < maxstd)
-               {
-                  _data.svrad.meas[i][k][j] = avg;
-                  _data.svrad.quals[i][k][j] = 1.0;
-               }
-            }
-         }
-      }
+         (this->*kernels.vrad)(i, meas);
    }
 }
 
 /**
    @brief Writes superobed data to file.
 */
-void HoofSuperober::write()
+template<typename T>
+void HoofSuperober<T>::write()
 {
    // write DBZ superobed data
    for(int i=0; i<_data.dbz.datasets.size(); i++)
@@ -611,3 +739,7 @@ void HoofSuperober::write()
       _outFile.writeDataset(dataset + "/quality1", "data", dataQual);           
    }
 }
+
+// --- instantiate for the [Precision] settings
+template class HoofSuperober<float>;
+template class HoofSuperober<double>;
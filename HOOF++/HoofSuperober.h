@@ -7,6 +7,9 @@
 #ifndef HOOFSUPEROBER_GUARD
 #define HOOFSUPEROBER_GUARD
 
+#include <string>
+#include <map>
+#include <utility>
 #include <HoofTypes.h>
 #include <HoofWorker.h>
 #include <HoofH5File.h>
@@ -15,7 +18,12 @@
 /**
    @class HoofSuperober
    @brief Worker object that makes super observations from DBZ and VRAD data.
+
+   The superobs are averaged in T, float or double as chosen with [Precision], and stored to HoofData in
+   double. The superobs of an elevation are made by kernels compiled for the common combinations of
+   [Range bin factor] and [Ray angle factor], which are chosen from a table, or by generic kernels.
 */
+template<typename T>
 class HoofSuperober : public HoofWorker
 {
    private:
@@ -28,8 +36,25 @@ class HoofSuperober : public HoofWorker
       hoof::vector3D<int> _startRayBorders; ///< Starts of superobed ray bins (nsel, nsr, nsaz).
       hoof::vector3D<int> _endRayBorders;   ///< Ends of superobed ray bins (nsel, nsr, nsaz).
 
+      /**
+         @struct Kernels
+         @brief Holds the DBZ and VRAD superob kernels for one combination of factors.
+      */
+      struct Kernels
+      {
+         void (HoofSuperober::*dbz)(int, const hoof::vector3D<T>&, const hoof::vector3D<T>&,
+            const hoof::vector3D<T>&, double);                                    ///< DBZ kernel.
+         void (HoofSuperober::*vrad)(int, const hoof::vector3D<T>&);              ///< VRAD kernel.
+      };
+      static const std::map<std::pair<int, int>, Kernels> _kernels;  ///< Compiled kernels by (range bin factor, ray angle factor).
+
       // gets superob bin borders for ranges, start rays and end rays
       void _calculateBinBorders(const std::string& type);
+      // makes the DBZ superobs of one elevation, for factors fixed at compile time or 0 for the settings
+      template<int BinF, int RayF> void _superobDbz(int i, const hoof::vector3D<T>& meas,
+         const hoof::vector3D<T>& ths, const hoof::vector3D<T>& quals, double dbzmin);
+      // makes the VRAD superobs of one elevation, for factors fixed at compile time or 0 for the settings
+      template<int BinF, int RayF> void _superobVrad(int i, const hoof::vector3D<T>& meas);
 
    public:
       // constructor
@@ -0,0 +1,342 @@
+/**
+   @file HoofSupervisor.cpp
+   @author Peter Smerkol
+   @brief Contains the HoofSupervisor class implementation.
+*/
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cerrno>
+#include <stdexcept>
+#include <cstring>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <HoofSettings.h>
+#include <HoofProcessor.h>
+#include <HoofArchive.h>
+#include <HoofScheduler.h>
+#include <HoofMemory.h>
+#include <HoofTrace.h>
+#include <HoofMetrics.h>
+#include <HoofLog.h>
+#include <HoofSupervisor.h>
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::endl;
+using std::ofstream;
+
+/**
+   @brief Constructor, starts the worker processes.
+   @param processor The processor that worker processes use to process files.
+   @param nWorkers Number of worker processes.
+*/
+HoofSupervisor::HoofSupervisor(const HoofProcessor& processor, int nWorkers) :
+   _processor(processor), _busy(0), _memoryInFlight(0.0)
+{
+   // a write to a dead worker must not kill the supervisor
+   signal(SIGPIPE, SIG_IGN);
+
+   _workers = vector<Worker>(nWorkers);
+   for(int i=0; i<nWorkers; i++)
+      _startWorker(i);
+}
+
+/**
+   @brief Destructor, stops the worker processes.
+*/
+HoofSupervisor::~HoofSupervisor()
+{
+   for(int i=0; i<_workers.size(); i++)
+      _stopWorker(i);
+}
+
+/**
+   @brief Forks a new worker process into a worker slot.
+   @param i The worker slot.
+*/
+void HoofSupervisor::_startWorker(int i)
+{
+   int toWorker[2];
+   int fromWorker[2];
+   if(pipe(toWorker) != 0 || pipe(fromWorker) != 0)
+      throw std::runtime_error("cannot create pipes for worker process");
+
+   // flush the console and the trace so buffered output is not duplicated in the child
+   cout.flush();
+   HoofTrace::flush();
+   pid_t pid = fork();
+   if(pid < 0)
+      throw std::runtime_error("cannot fork worker process");
+
+   // child: close pipes that belong to other workers, so they see EOF when the supervisor closes them
+   if(pid == 0)
+   {
+      close(toWorker[1]);
+      close(fromWorker[0]);
+      for(int j=0; j<_workers.size(); j++)
+      {
+         if(_workers[j].pid > 0)
+         {
+            close(_workers[j].toWorker);
+            close(_workers[j].fromWorker);
+         }
+      }
+      _workerLoop(toWorker[0], fromWorker[1]);
+   }
+
+   // parent: keep only our ends of the pipes
+   close(toWorker[0]);
+   close(fromWorker[1]);
+   _workers[i] = Worker();
+   _workers[i].pid = pid;
+   _workers[i].toWorker = toWorker[1];
+   _workers[i].fromWorker = fromWorker[0];
+}
+
+/**
+   @brief Stops a worker process by closing its pipes and waits for it to exit.
+   @param i The worker slot.
+*/
+void HoofSupervisor::_stopWorker(int i)
+{
+   Worker& w = _workers[i];
+   if(w.pid <= 0)
+      return;
+   close(w.toWorker);
+   close(w.fromWorker);
+   waitpid(w.pid, nullptr, 0);
+   w = Worker();
+}
+
+/**
+   @brief Main loop of the worker process. Reads file names from the supervisor, processes them and
+      replies with 1 on success and 0 on failure, followed by the allocations and peak memory of the file
+      with memory profiling and by the metrics record of the file after a '|' with metrics. Exits when the
+      supervisor closes the pipe.
+   @param in File descriptor to read file names from.
+   @param out File descriptor to write results to.
+*/
+void HoofSupervisor::_workerLoop(int in, int out) const
+{
+   FILE* input = fdopen(in, "r");
+   char line[4096];
+   HoofTrace::nameThread("worker");
+   while(true)
+   {
+      {
+         HoofTrace::Scope scope("Wait for file", "queue");
+         if(fgets(line, sizeof(line), input) == nullptr)
+            break;
+      }
+      string fileName(line);
+      if(!fileName.empty() && fileName.back() == '\n')
+         fileName.pop_back();
+      bool ok = _processor.process(fileName);
+      HoofArchive::removeAssembled(fileName);
+      cout.flush();
+      string reply = ok ? "1" : "0";
+      if(ok && HoofMemory::counting)
+         reply += " " + HoofMemory::lastRecord();
+      if(ok && HoofMetrics::enabled())
+         reply += "|" + HoofMetrics::take();
+      reply += "\n";
+      if(write(out, reply.c_str(), reply.size()) != (ssize_t)reply.size())
+         break;
+   }
+   cout.flush();
+   HoofTrace::flush();
+   HoofLog::stop();
+   _exit(0);
+}
+
+/**
+   @brief Sends a job to an idle worker.
+   @param i The worker slot.
+   @param job The job with the file to process.
+*/
+void HoofSupervisor::_send(int i, const HoofJob& job)
+{
+   // a failed write means the worker is dead, which is detected when polling for its reply
+   string line = job.fileName + "\n";
+   _workers[i].fileName = job.fileName;
+   _workers[i].job = job;
+   if(write(_workers[i].toWorker, line.c_str(), line.size()) != (ssize_t)line.size())
+      cout << "Could not send file " << job.fileName << " to worker " << _workers[i].pid << endl;
+}
+
+/**
+   @brief Writes a file that crashed a worker to the quarantine list.
+   @param fileName The crashed file.
+   @param status Exit status of the worker as returned by waitpid.
+*/
+void HoofSupervisor::_quarantine(const string& fileName, int status)
+{
+   string reason = "exited with status " + std::to_string(WEXITSTATUS(status));
+   if(WIFSIGNALED(status))
+      reason = string("killed by signal ") + strsignal(WTERMSIG(status));
+   cout << "Worker processing file " << fileName << " " << reason << ", file put into quarantine" << endl;
+
+   quarantined.push_back(fileName);
+   ofstream list(HoofSettings::outFolder + HoofSettings::quarantineList, std::ios::app);
+   list << fileName << " " << reason << endl;
+}
+
+/**
+   @brief Gives an idle worker the next job, if it fits into the memory budget.
+
+   A job that does not fit next to the jobs in flight is held back and no other job is started
+   until it fits, so a file too large for the budget ends up being processed alone.
+
+   @param i The idle worker slot.
+   @param scheduler The scheduler holding the files to process.
+   @return True if a job was sent to the worker, false otherwise.
+*/
+bool HoofSupervisor::_dispatch(int i, HoofScheduler& scheduler)
+{
+   std::optional<HoofJob> job = _held ? _held : scheduler.next(i);
+   _held = std::nullopt;
+   if(!job)
+      return false;
+
+   double budget = HoofSettings::maxMemory * 1024.0 * 1024.0;
+   if(budget > 0.0 && _busy > 0 && _memoryInFlight + job.value().memory > budget)
+   {
+      _held = job;
+      return false;
+   }
+   if(budget > 0.0 && job.value().memory > budget)
+      cout << "File " << job.value().fileName << " needs about " << (int)(job.value().memory/1048576.0) <<
+         " MB, more than the memory budget, processing it alone" << endl;
+
+   _send(i, job.value());
+   _memoryInFlight += job.value().memory;
+   _busy++;
+   return true;
+}
+
+/**
+   @brief Processes scheduled files in the worker processes.
+
+   Each idle worker gets the next job from the scheduler, as long as it fits into the memory budget.
+   When a worker dies, its file is put into quarantine, the worker is restarted and the batch continues.
+
+   @param scheduler The scheduler holding the files to process, one queue per worker.
+   @return The number of successfully processed files.
+*/
+int HoofSupervisor::run(HoofScheduler& scheduler)
+{
+   int goodFiles = 0;
+   _busy = 0;
+   _memoryInFlight = 0.0;
+   _held = std::nullopt;
+
+   // give every worker its first file
+   for(int i=0; i<_workers.size(); i++)
+   {
+      if(!_dispatch(i, scheduler))
+         break;
+   }
+
+   // wait for replies and hand out remaining files
+   while(_busy > 0)
+   {
+      vector<pollfd> fds;
+      vector<int> slots;
+      for(int i=0; i<_workers.size(); i++)
+      {
+         if(!_workers[i].fileName.empty())
+         {
+            fds.push_back({_workers[i].fromWorker, POLLIN, 0});
+            slots.push_back(i);
+         }
+      }
+      int ready;
+      {
+         HoofTrace::Scope scope("Wait for workers", "queue");
+         ready = poll(fds.data(), fds.size(), -1);
+      }
+      if(ready < 0)
+      {
+         if(errno == EINTR)
+            continue;
+         throw std::runtime_error("poll on worker pipes failed");
+      }
+
+      for(int f=0; f<fds.size(); f++)
+      {
+         if(fds[f].revents == 0)
+            continue;
+         int i = slots[f];
+         char buffer[4096];
+         ssize_t n = read(_workers[i].fromWorker, buffer, sizeof(buffer));
+         if(n < 0 && errno == EINTR)
+            continue;
+
+         // a reply is one line, which can arrive in several reads
+         if(n > 0)
+         {
+            _workers[i].reply.append(buffer, n);
+            if(_workers[i].reply.find('\n') == string::npos)
+               continue;
+         }
+         _memoryInFlight -= _workers[i].job.memory;
+         _busy--;
+
+         // the worker replied, so it is alive and idle
+         if(n > 0)
+         {
+            string reply = _workers[i].reply.substr(0, _workers[i].reply.find('\n'));
+            _workers[i].reply = "";
+            if(reply[0] == '1')
+            {
+               goodFiles++;
+               size_t record = reply.find('|');
+               if(record != string::npos)
+                  HoofMetrics::add(reply.substr(record+1));
+               scheduler.finish(_workers[i].job);
+               long long allocations = 0;
+               long long bytes = 0;
+               long peakRss = 0;
+               if(sscanf(reply.c_str(), "1 %lld %lld %ld", &allocations, &bytes, &peakRss) == 3)
+                  HoofMemory::record(_workers[i].fileName, allocations, bytes, peakRss);
+            }
+            else
+               HoofMetrics::failed();
+            HoofArchive::removeAssembled(_workers[i].fileName);
+            _workers[i].fileName = "";
+         }
+         // the worker died, quarantine its file and restart it
+         else
+         {
+            string crashed = _workers[i].fileName;
+            int status = 0;
+            close(_workers[i].toWorker);
+            close(_workers[i].fromWorker);
+            waitpid(_workers[i].pid, &status, 0);
+            _workers[i] = Worker();
+            _quarantine(crashed, status);
+            HoofArchive::removeAssembled(crashed);
+            HoofMetrics::failed();
+            _startWorker(i);
+         }
+      }
+
+      // freed memory may admit more jobs, so try all idle workers
+      for(int i=0; i<_workers.size(); i++)
+      {
+         if(_workers[i].fileName.empty() && !_dispatch(i, scheduler))
+            break;
+      }
+   }
+
+   return goodFiles;
+}
@@ -0,0 +1,75 @@
+/**
+   @file HoofSupervisor.h
+   @author Peter Smerkol
+   @brief Contains definition of HoofSupervisor class.
+*/
+
+#ifndef HOOFSUPERVISOR_GUARD
+#define HOOFSUPERVISOR_GUARD
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <sys/types.h>
+#include <HoofProcessor.h>
+#include <HoofScheduler.h>
+
+/**
+   @class HoofSupervisor
+   @brief Class that processes files in a pool of forked worker processes.
+
+   File names are sent to the workers over pipes and workers reply with the result of processing.
+   A worker that dies (segfault, stack overflow, ...) is restarted and its file is put into quarantine,
+   so a crash only costs one file instead of the rest of the batch. With a memory budget, files are
+   only started when their estimated memory fits next to the files being processed.
+*/
+class HoofSupervisor
+{
+   private:
+      /**
+         @struct Worker
+         @brief Holds the state of one worker process.
+      */
+      struct Worker
+      {
+         pid_t pid = -1;         ///< Process id of the worker.
+         int toWorker = -1;      ///< Write end of the pipe that sends file names to the worker.
+         int fromWorker = -1;    ///< Read end of the pipe that receives results from the worker.
+         std::string fileName;   ///< File currently processed by the worker, empty if idle.
+         HoofJob job;            ///< Job currently processed by the worker.
+         std::string reply;      ///< Reply read so far, it is complete at its newline.
+      };
+
+      // members
+      const HoofProcessor& _processor;  ///< The processor used by worker processes.
+      std::vector<Worker> _workers;     ///< The pool of worker processes.
+      int _busy;                        ///< Number of workers processing a file.
+      double _memoryInFlight;           ///< Estimated memory in bytes of the files being processed.
+      std::optional<HoofJob> _held;     ///< Job waiting for memory to be freed.
+
+      // forks a new worker process into slot i
+      void _startWorker(int i);
+      // stops a worker process and waits for it
+      void _stopWorker(int i);
+      // main loop of the worker process, never returns
+      [[noreturn]] void _workerLoop(int in, int out) const;
+      // sends a job to an idle worker
+      void _send(int i, const HoofJob& job);
+      // gives an idle worker the next job if it fits into the memory budget
+      bool _dispatch(int i, HoofScheduler& scheduler);
+      // writes a crashed file to the quarantine list
+      void _quarantine(const std::string& fileName, int status);
+
+   public:
+      // members
+      std::vector<std::string> quarantined;  ///< Files that crashed a worker process.
+
+      // constructor, starts the worker processes
+      HoofSupervisor(const HoofProcessor& processor, int nWorkers);
+      // destructor, stops the worker processes
+      ~HoofSupervisor();
+      // processes the scheduled files in worker processes and returns the number of successfully processed files
+      int run(HoofScheduler& scheduler);
+};
+
+#endif // HOOFSUPERVISOR_GUARD
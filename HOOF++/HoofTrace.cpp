@@ -0,0 +1,181 @@
+/**
+   @file HoofTrace.cpp
+   @author Peter Smerkol
+   @brief Contains the HoofTrace class implementation.
+*/
+
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <iostream>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <HoofTypes.h>
+#include <HoofTrace.h>
+
+using std::string;
+using std::to_string;
+using std::cout;
+using std::endl;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using namespace hoof;
+
+// --- initialize static members
+string HoofTrace::_path = "";
+std::mutex HoofTrace::_mutex;
+string HoofTrace::_buffer = "";
+thread_local string HoofTrace::_fileName = "";
+
+/**
+   @brief Escapes a string for a JSON string value.
+   @param text The string.
+   @return The escaped string.
+*/
+static string escape(const string& text)
+{
+   string escaped;
+   for(char c : text)
+   {
+      if(c == '"' || c == '\\')
+         escaped += '\\';
+      escaped += c;
+   }
+   return escaped;
+}
+
+/**
+   @brief Gives the process and thread id of the calling thread as JSON fields.
+   @return The fields.
+*/
+static string ids()
+{
+   return "\"pid\":" + to_string(getpid()) + ",\"tid\":" + to_string(syscall(SYS_gettid));
+}
+
+/**
+   @brief Constructor, takes the begin time of the event if tracing is enabled.
+   @param name Name of the event.
+   @param category Category of the event.
+*/
+HoofTrace::Scope::Scope(const char* name, const char* category) : _name(name), _category(category), _begin(-1)
+{
+   if(HoofTrace::enabled())
+      _begin = HoofTrace::micros(Clock::now());
+}
+
+/**
+   @brief Destructor, records the event.
+*/
+HoofTrace::Scope::~Scope()
+{
+   if(_begin >= 0)
+      HoofTrace::event(_name, _category, _begin, HoofTrace::micros(Clock::now()));
+}
+
+/**
+   @brief Starts a trace file, replacing an existing one, and enables tracing.
+   @param tracePath Path of the trace file.
+*/
+void HoofTrace::start(const string& tracePath)
+{
+   int fd = open(tracePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if(fd < 0 || write(fd, "[\n", 2) != 2)
+   {
+      cout << "Could not write trace file " << tracePath << ", tracing disabled" << endl;
+      if(fd >= 0)
+         close(fd);
+      return;
+   }
+   close(fd);
+   _path = tracePath;
+   nameThread("main");
+}
+
+/**
+   @brief Sets the file processed by the calling thread, which is added to its events.
+   @param fileName Name of the file, empty for events that belong to no file.
+*/
+void HoofTrace::setFile(const string& fileName)
+{
+   _fileName = fileName;
+}
+
+/**
+   @brief Names the calling thread in the timeline.
+   @param name Name of the thread.
+*/
+void HoofTrace::nameThread(const string& name)
+{
+   if(!enabled())
+      return;
+   _append("{\"name\":\"thread_name\",\"ph\":\"M\"," + ids() + ",\"args\":{\"name\":\"" + escape(name) + "\"}}");
+}
+
+/**
+   @brief Converts a time point to microseconds. The clock is the same in all processes, so events of
+      worker processes line up with the supervisor.
+   @param time The time point.
+   @return Microseconds since the epoch of the clock.
+*/
+long long HoofTrace::micros(const Time& time)
+{
+   return duration_cast<microseconds>(time.time_since_epoch()).count();
+}
+
+/**
+   @brief Records an event of the calling thread.
+   @param name Name of the event.
+   @param category Category of the event, e.g. stage, hdf5 or queue.
+   @param begin Begin time in microseconds.
+   @param end End time in microseconds.
+*/
+void HoofTrace::event(const string& name, const char* category, long long begin, long long end)
+{
+   if(!enabled())
+      return;
+   string record = "{\"name\":\"" + escape(name) + "\",\"cat\":\"" + category + "\",\"ph\":\"X\",\"ts\":" +
+      to_string(begin) + ",\"dur\":" + to_string(end - begin) + "," + ids();
+   if(!_fileName.empty())
+      record += ",\"args\":{\"file\":\"" + escape(_fileName) + "\"}";
+   _append(record + "}");
+}
+
+/**
+   @brief Appends one JSON record to the buffer, which is written when it gets large.
+   @param record The record.
+*/
+void HoofTrace::_append(const string& record)
+{
+   bool full = false;
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _buffer += record + ",\n";
+      full = _buffer.size() > (1 << 16);
+   }
+   if(full)
+      flush();
+}
+
+/**
+   @brief Appends the buffered events to the trace file with a single write, so events of worker
+      processes writing at the same time are not mixed.
+*/
+void HoofTrace::flush()
+{
+   if(!enabled())
+      return;
+   string events;
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      events.swap(_buffer);
+   }
+   if(events.empty())
+      return;
+   int fd = open(_path.c_str(), O_WRONLY | O_APPEND);
+   if(fd < 0 || write(fd, events.c_str(), events.size()) != (ssize_t)events.size())
+      cout << "Could not write trace file " << _path << endl;
+   if(fd >= 0)
+      close(fd);
+}
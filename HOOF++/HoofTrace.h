@@ -0,0 +1,72 @@
+/**
+   @file HoofTrace.h
+   @author Peter Smerkol
+   @brief Contains definition of HoofTrace class.
+*/
+
+#ifndef HOOFTRACE_GUARD
+#define HOOFTRACE_GUARD
+
+#include <string>
+#include <mutex>
+#include <HoofTypes.h>
+
+/**
+   @class HoofTrace
+   @brief Class that records a timeline of stages, HDF5 reads and writes and queue waits in the Trace
+      Event format, which can be opened in Perfetto or chrome://tracing.
+
+   Events are complete events with a begin time and a duration, tagged with the process and thread id and
+   the file being processed. They are buffered and appended to the trace file with single writes on a
+   descriptor opened with O_APPEND, so worker processes can write to the same trace file. The closing
+   bracket of the event array is left out, which the format allows.
+*/
+class HoofTrace
+{
+   public:
+      /**
+         @class Scope
+         @brief Records an event from its construction to its destruction.
+      */
+      class Scope
+      {
+         private:
+            // members
+            const char* _name;       ///< Name of the event.
+            const char* _category;   ///< Category of the event.
+            long long _begin;        ///< Begin time in microseconds, -1 if tracing is disabled.
+
+         public:
+            // constructor, takes the begin time
+            Scope(const char* name, const char* category);
+            // destructor, records the event
+            ~Scope();
+      };
+
+      // starts a trace file, tracing is disabled until this is called
+      static void start(const std::string& tracePath);
+      // checks if tracing is enabled
+      static bool enabled() { return !_path.empty(); }
+      // sets the file processed by the calling thread, added to its events
+      static void setFile(const std::string& fileName);
+      // names the calling thread in the timeline
+      static void nameThread(const std::string& name);
+      // converts a time point to microseconds
+      static long long micros(const hoof::Time& time);
+      // records an event with begin and end time in microseconds
+      static void event(const std::string& name, const char* category, long long begin, long long end);
+      // appends the buffered events to the trace file
+      static void flush();
+
+   private:
+      // members
+      static std::string _path;                     ///< Path of the trace file, empty if tracing is disabled.
+      static std::mutex _mutex;                     ///< Guards the event buffer.
+      static std::string _buffer;                   ///< Events not yet written to the trace file.
+      static thread_local std::string _fileName;    ///< File processed by the calling thread.
+
+      // appends one JSON record to the buffer
+      static void _append(const std::string& record);
+};
+
+#endif // HOOFTRACE_GUARD
@@ -24,6 +24,8 @@ namespace hoof
    using Clock = std::chrono::high_resolution_clock;
    using Time = std::chrono::time_point<Clock>;
    using Ms = std::chrono::milliseconds;
+   using WallClock = std::chrono::system_clock;
+   using WallTime = std::chrono::time_point<WallClock>;
 
    // shorthands for NaN values
    constexpr double dNaN = std::numeric_limits<double>::quiet_NaN();
@@ -7,13 +7,11 @@
 #include <string>
 #include <vector>
 #include <iostream>
-#include <fstream>
 #include <HoofSettings.h>
 #include <HoofWorker.h>
 
 using std::cout;
 using std::endl;
-using std::ofstream;
 using std::string;
 using std::vector;
 
@@ -27,42 +25,48 @@ HoofWorker::HoofWorker()
 
 /**
    @brief Adds a warning.
+   @param code Short code of the warning.
    @param warn The warning string.
 */
-void HoofWorker::warning(const string& warn)
+void HoofWorker::warning(const string& code, const string& warn)
 {
-   warnings.push_back(classMessage + " - " + warn);
+   warnings.push_back({HoofSettings::warningTag, "", "", classMessage, code, warn});
 }
 
 /**
    @brief Adds an error.
+   @param code Short code of the error.
    @param err The error string.
 */
-void HoofWorker::error(const string& err)
+void HoofWorker::error(const string& code, const string& err)
 {
-   errors.push_back(classMessage + " - " + err);
+   errors.push_back({HoofSettings::errorTag, "", "", classMessage, code, err});
 }
 
 /**
-   @brief Outputs warnings and/or errors to console and/or log.
-   @param logfile A stream from an opened log file to which to write to.
+   @brief Outputs warnings and/or errors to console and hands them to the log sink, which writes them
+      to the log file of the input file.
+   @param fileName Name of the input file.
+   @param site Radar site of the input file.
 */
-void HoofWorker::output(ofstream& logfile)
+void HoofWorker::output(const string& fileName, const string& site)
 {
    // output warnings
    for(int i=0; i<warnings.size(); i++)
    {
-      if(HoofSettings::printLogWarnings)
-         logfile << HoofSettings::warningTag << ": " << warnings[i] << endl;
+      HoofLog::Record& w = warnings[i];
       if(HoofSettings::printConsoleWarnings)
-         cout << "    " << HoofSettings::warningTag << ": " << warnings[i] << endl;
+         cout << "    " << w.level << ": " << w.stage << " - " << w.message << "\n";
+      if(HoofSettings::printLogWarnings)
+         HoofLog::submit({w.level, site, fileName, w.stage, w.code, w.message});
    }
 
    // output errors
    for(int i=0; i<errors.size(); i++)
    {
-      logfile << HoofSettings::errorTag << ": " << errors[i] << endl;
+      HoofLog::Record& e = errors[i];
       if(HoofSettings::printConsoleErrors)
-         cout << "    " << HoofSettings::errorTag << ": " << errors[i] << endl;
+         cout << "    " << e.level << ": " << e.stage << " - " << e.message << "\n";
+      HoofLog::submit({e.level, site, fileName, e.stage, e.code, e.message});
    }
-}
\ No newline at end of file
+}
@@ -9,30 +9,31 @@
 
 #include <string>
 #include <vector>
-#include <fstream>
+#include <HoofLog.h>
 
 /**
    @class HoofWorker
    @brief Class that handles output of warnings and errors.
 
-   Serves as the base class for all worker objects.
+   Serves as the base class for all worker objects. Warnings and errors are kept as structured records
+   and written to the log file by the HoofLog sink thread.
 */
 class HoofWorker
 {
    public:
       // members
       std::string classMessage;          ///< String that gets added at the beginning of warnings and errors.
-      std::vector<std::string> warnings; ///< Generated warning texts.
-      std::vector<std::string> errors;   ///< Generated error texts.
+      std::vector<HoofLog::Record> warnings;  ///< Generated warnings.
+      std::vector<HoofLog::Record> errors;    ///< Generated errors.
 
       // constructor
       HoofWorker();
       // adds a warning
-      void warning(const std::string& warn);        
+      void warning(const std::string& code, const std::string& warn);
       // adds an error
-      void error(const std::string& err);
+      void error(const std::string& code, const std::string& err);
       // outputs warning and/or errors to console and/or log
-      void output(std::ofstream& logfile);
+      void output(const std::string& fileName, const std::string& site);
 };
 
 #endif // HOOFWORKER_GUARD
\ No newline at end of file
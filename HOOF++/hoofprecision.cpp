@@ -0,0 +1,187 @@
+/**
+   @file hoofprecision.cpp
+   @author Peter Smerkol
+   @brief Validation and benchmark of the [Precision] settings.
+
+   Processes all files in the input folder with the namelist, once with [Precision] FLOAT64 into the
+   float64 subfolder of the output folder and once with FLOAT32 into the float32 subfolder, and prints the
+   processing time of both. Then it compares the 8-bit data and quality datasets of the two outputs of
+   each file and prints the largest difference in encoded units and how many values differ. Exits with 1
+   if a value differs by more than one encoded unit.
+
+   Compiling:
+   h5c++ -std=c++17 -O2 -o hoofprecision -I. Hoof*.cpp hoofprecision.cpp -lgsl -lgslcblas -lz -pthread
+
+   Running:
+   ./hoofprecision <namelist file> <input folder> <output folder>
+*/
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <HoofTypes.h>
+#include <HoofSettings.h>
+#include <HoofH5File.h>
+#include <HoofArchive.h>
+#include <HoofIOThread.h>
+#include <HoofProcessor.h>
+#include <HoofLog.h>
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::endl;
+using std::filesystem::directory_iterator;
+using std::filesystem::exists;
+using namespace hoof;
+
+/**
+   @struct Difference
+   @brief Holds the differences of the encoded values of two outputs.
+*/
+struct Difference
+{
+   int maxCodes = 0;             ///< Largest difference in encoded units.
+   string maxAt;                 ///< Dataset with the largest difference.
+   long long differing = 0;      ///< Number of values that differ.
+   long long values = 0;         ///< Number of values compared.
+};
+
+/**
+   @brief Processes the files with one precision into a subfolder of the output folder.
+   @param fileNames Names of the files in the input folder.
+   @param precision FLOAT64 or FLOAT32.
+   @param outFolder Output folder, with a trailing slash.
+   @return Processing time in seconds.
+*/
+static double run(const vector<string>& fileNames, const string& precision, const string& outFolder)
+{
+   HoofSettings::precision = precision;
+   HoofSettings::outFolder = outFolder;
+   std::filesystem::create_directories(outFolder);
+   HoofProcessor processor;
+   Clock clock;
+   Time start = clock.now();
+   for(const string& fileName : fileNames)
+      processor.process(fileName);
+   processor.flush();
+   return std::chrono::duration<double>(clock.now() - start).count();
+}
+
+/**
+   @brief Compares the 8-bit data and quality datasets of the two outputs of a file.
+   @param file64 Path of the FLOAT64 output.
+   @param file32 Path of the FLOAT32 output.
+   @param diff Receives the differences.
+*/
+static void compare(const string& file64, const string& file32, Difference& diff)
+{
+   HoofH5File out64(file64, "read");
+   HoofH5File out32(file32, "read");
+   for(const string& dataset : out64.getDatasets())
+   {
+      for(const string type : {"data", "quality"})
+      {
+         for(const string& data : out64.getDatas("/" + dataset, type))
+         {
+            string group = "/" + dataset + "/" + data;
+            auto values64 = out64.getDataset(group, "data");
+            auto values32 = out32.getDataset(group, "data");
+            if(!values64 || !values32 || values64->size() != values32->size())
+            {
+               cout << "   " << group << " has other dimensions or is missing in the FLOAT32 output" << endl;
+               continue;
+            }
+            for(int j=0; j<values64->size(); j++)
+            {
+               const vector<unsigned char>& row64 = (*values64)[j];
+               const vector<unsigned char>& row32 = (*values32)[j];
+               for(int k=0; k<std::min(row64.size(), row32.size()); k++)
+               {
+                  int codes = std::abs((int)row64[k] - (int)row32[k]);
+                  diff.values++;
+                  if(codes == 0)
+                     continue;
+                  diff.differing++;
+                  if(codes > diff.maxCodes)
+                  {
+                     diff.maxCodes = codes;
+                     diff.maxAt = group;
+                  }
+               }
+            }
+         }
+      }
+   }
+   out64.close();
+   out32.close();
+}
+
+// ---------------------------------------------------------------------------------
+// -------------------- main function ----------------------------------------------
+// ---------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+   if(argc < 4)
+   {
+      cout << "Wrong number of command line arguments, the syntax is:" << endl;
+      cout << "./hoofprecision <namelist file> <input folder> <output folder>" << endl;
+      return -1;
+   }
+
+   // same fallbacks as HOOF2, files are processed in this process
+   string outFolder = argv[3];
+   HoofSettings settings(argv[1], argv[2], outFolder);
+   if(HoofSettings::outputMode == "SUPEROBS" && !HoofSettings::superobing)
+      HoofSettings::outputMode = "PLANNED";
+   if(HoofSettings::writeBehind && !HoofIOThread::available())
+      HoofSettings::writeBehind = false;
+
+   // get files in the input folder and in its archives that have the correct extensions
+   vector<string> fileNames;
+   for(auto& entry : directory_iterator(argv[2]))
+   {
+      vector<string> inputs = HoofArchive::inputs(entry.path().filename().string());
+      fileNames.insert(fileNames.end(), inputs.begin(), inputs.end());
+   }
+   std::sort(fileNames.begin(), fileNames.end());
+
+   // process all files in both precisions
+   double time64 = run(fileNames, "FLOAT64", outFolder + "float64/");
+   double time32 = run(fileNames, "FLOAT32", outFolder + "float32/");
+   HoofLog::stop();
+
+   // compare the outputs file by file
+   cout << "--------------- comparing FLOAT32 to FLOAT64 output" << endl;
+   Difference total;
+   for(const string& fileName : fileNames)
+   {
+      string outName = HoofArchive::outputName(fileName);
+      string file64 = outFolder + "float64/" + outName;
+      string file32 = outFolder + "float32/" + outName;
+      if(!exists(file64) || !exists(file32))
+      {
+         cout << outName << ": no output in " << (exists(file64) ? "FLOAT32" : "FLOAT64") << endl;
+         continue;
+      }
+      Difference diff;
+      compare(file64, file32, diff);
+      cout << outName << ": " << diff.differing << " of " << diff.values << " values differ, largest difference " <<
+         diff.maxCodes << (diff.maxCodes > 0 ? " in " + diff.maxAt : "") << endl;
+      total.values += diff.values;
+      total.differing += diff.differing;
+      if(diff.maxCodes > total.maxCodes)
+      {
+         total.maxCodes = diff.maxCodes;
+         total.maxAt = outName + diff.maxAt;
+      }
+   }
+   cout << "Processing time: FLOAT64 " << time64 << " s, FLOAT32 " << time32 << " s" << endl;
+   cout << "Largest difference " << total.maxCodes << " encoded units" << (total.maxCodes > 0 ? " in " + total.maxAt : "") <<
+      ", " << total.differing << " of " << total.values << " values differ" << endl;
+   return total.maxCodes > 1 ? 1 : 0;
+}
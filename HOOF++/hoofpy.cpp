@@ -0,0 +1,424 @@
+/**
+   @file hoofpy.cpp
+   @author Peter Smerkol
+   @brief Contains the hoof Python extension module, which runs HOOF++ from Python.
+
+   The module parses the namelist once and processes files in the Python process with HoofHomogenizer,
+   HoofDealiaser and HoofSuperober, returning the volume as a dict of hoof.Array objects. hoof.Array
+   exports its values through the buffer protocol, so numpy.asarray() and memoryview() use them without
+   copying. The nested vectors of HoofData are copied once into one contiguous buffer per array, padded
+   with NaN where elevations have fewer azimuths or bins than the maximum. Output files are written as
+   with HOOF2. Only the CPython C API is used, numpy is not needed to build the module.
+
+   The GIL is released while a file is processed, so other Python threads run, but the module functions
+   take one lock, so files are processed one at a time.
+
+   Building:
+   h5c++ -shared -fPIC $(python3-config --includes) -o hoof$(python3-config --extension-suffix) -I. Hoof*.cpp hoofpy.cpp -lgsl -lz -O2
+
+   Usage:
+   import hoof, numpy
+   hoof.open("HOOF_namelist.nam", "in/", "out/")
+   volume = hoof.process("T_PAGZ41_C_LJLM_20240206121500_lisca.h5")
+   sdbz = numpy.asarray(volume["sdbz"]["values"])
+   failed = hoof.flush()
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <mutex>
+#include <HoofTypes.h>
+#include <HoofSettings.h>
+#include <HoofData.h>
+#include <HoofMeasurement.h>
+#include <HoofProcessor.h>
+#include <HoofIOThread.h>
+#include <HoofLog.h>
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+using namespace hoof;
+
+/**
+   @struct HoofArray
+   @brief Python object that owns a contiguous array of doubles with up to three dimensions.
+*/
+struct HoofArray
+{
+   PyObject_HEAD
+   vector<double>* values;   ///< Values in C order.
+   int ndim;                 ///< Number of dimensions.
+   Py_ssize_t shape[3];      ///< Size of each dimension.
+   Py_ssize_t strides[3];    ///< Bytes between neighbours in each dimension.
+};
+
+static unique_ptr<HoofProcessor> processor;   ///< Processor of the opened namelist.
+static std::mutex hoofMutex;                  ///< Serializes open, process and flush, HDF5 and the settings are not thread-safe.
+
+/**
+   @brief Fills the buffer view of a hoof.Array, which shares its values without copying.
+   @param self The array.
+   @param view The view to fill.
+   @param flags Requested buffer features.
+   @return 0 on success.
+*/
+static int arrayGetBuffer(PyObject* self, Py_buffer* view, int flags)
+{
+   HoofArray* array = (HoofArray*)self;
+   view->obj = self;
+   view->buf = array->values->data();
+   view->len = array->values->size()*sizeof(double);
+   view->readonly = 0;
+   view->itemsize = sizeof(double);
+   view->format = (flags & PyBUF_FORMAT) ? (char*)"d" : nullptr;
+   view->ndim = array->ndim;
+   view->shape = (flags & PyBUF_ND) ? array->shape : nullptr;
+   view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? array->strides : nullptr;
+   view->suboffsets = nullptr;
+   view->internal = nullptr;
+   Py_INCREF(self);
+   return 0;
+}
+
+/**
+   @brief Frees a hoof.Array.
+   @param self The array.
+*/
+static void arrayDealloc(PyObject* self)
+{
+   delete ((HoofArray*)self)->values;
+   Py_TYPE(self)->tp_free(self);
+}
+
+/**
+   @brief Gets the shape of a hoof.Array.
+   @param self The array.
+   @return Tuple with the size of each dimension.
+*/
+static PyObject* arrayShape(PyObject* self, void*)
+{
+   HoofArray* array = (HoofArray*)self;
+   PyObject* shape = PyTuple_New(array->ndim);
+   for(int i=0; i<array->ndim; i++)
+      PyTuple_SET_ITEM(shape, i, PyLong_FromSsize_t(array->shape[i]));
+   return shape;
+}
+
+static PyBufferProcs arrayBuffer = {arrayGetBuffer, nullptr};
+static PyGetSetDef arrayGetSet[] = {
+   {"shape", arrayShape, nullptr, "Size of each dimension.", nullptr},
+   {nullptr}
+};
+static PyTypeObject arrayType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+/**
+   @brief Creates a hoof.Array that takes over a buffer of values.
+   @param values Values in C order.
+   @param shape Size of each dimension.
+   @return The array, or None if it has no values.
+*/
+static PyObject* newArray(vector<double>&& values, const vector<Py_ssize_t>& shape)
+{
+   if(values.empty())
+      Py_RETURN_NONE;
+   HoofArray* array = PyObject_New(HoofArray, &arrayType);
+   if(array == nullptr)
+      return nullptr;
+   array->values = new vector<double>(std::move(values));
+   array->ndim = shape.size();
+   Py_ssize_t stride = sizeof(double);
+   for(int i=array->ndim-1; i>=0; i--)
+   {
+      array->shape[i] = shape[i];
+      array->strides[i] = stride;
+      stride *= shape[i];
+   }
+   return (PyObject*)array;
+}
+
+/**
+   @brief Copies a vector into a hoof.Array.
+   @param source The vector.
+   @return The array, or None if the vector is empty.
+*/
+static PyObject* toArray(const vector<double>& source)
+{
+   return newArray(vector<double>(source), {(Py_ssize_t)source.size()});
+}
+
+/**
+   @brief Copies a 2D vector into a contiguous hoof.Array, rows shorter than the longest are padded
+      with NaN.
+   @param source The 2D vector.
+   @return The array, or None if the vector is empty.
+*/
+static PyObject* toArray(const vector2D<double>& source)
+{
+   size_t n1 = source.size();
+   size_t n2 = 0;
+   for(const auto& row : source)
+      n2 = std::max(n2, row.size());
+   vector<double> values(n1*n2, std::numeric_limits<double>::quiet_NaN());
+   for(size_t i=0; i<n1; i++)
+      std::copy(source[i].begin(), source[i].end(), values.begin() + i*n2);
+   return newArray(std::move(values), {(Py_ssize_t)n1, (Py_ssize_t)n2});
+}
+
+/**
+   @brief Copies a 3D vector into a contiguous hoof.Array, rows shorter than the longest are padded
+      with NaN.
+   @param source The 3D vector.
+   @return The array, or None if the vector is empty.
+*/
+static PyObject* toArray(const vector3D<double>& source)
+{
+   size_t n1 = source.size();
+   size_t n2 = 0;
+   size_t n3 = 0;
+   for(const auto& plane : source)
+   {
+      n2 = std::max(n2, plane.size());
+      for(const auto& row : plane)
+         n3 = std::max(n3, row.size());
+   }
+   vector<double> values(n1*n2*n3, std::numeric_limits<double>::quiet_NaN());
+   for(size_t i=0; i<n1; i++)
+   {
+      for(size_t j=0; j<source[i].size(); j++)
+         std::copy(source[i][j].begin(), source[i][j].end(), values.begin() + (i*n2 + j)*n3);
+   }
+   return newArray(std::move(values), {(Py_ssize_t)n1, (Py_ssize_t)n2, (Py_ssize_t)n3});
+}
+
+/**
+   @brief Sets an item of a dict and releases the reference to its value.
+   @param dict The dict.
+   @param key Key of the item.
+   @param value Value of the item, a new reference.
+   @return True on success.
+*/
+static bool setItem(PyObject* dict, const char* key, PyObject* value)
+{
+   if(value == nullptr)
+      return false;
+   int status = PyDict_SetItemString(dict, key, value);
+   Py_DECREF(value);
+   return status == 0;
+}
+
+/**
+   @brief Converts one measurement to a dict of hoof.Array objects.
+   @param m The measurement.
+   @return The dict, or None if the measurement has no data.
+*/
+static PyObject* toDict(const HoofMeasurement& m)
+{
+   if(m.meas.empty())
+      Py_RETURN_NONE;
+   PyObject* dict = PyDict_New();
+   if(dict == nullptr)
+      return nullptr;
+   if(!setItem(dict, "values", toArray(m.meas)) ||
+      !setItem(dict, "quality", toArray(m.quals)) ||
+      !setItem(dict, "th", toArray(m.ths)) ||
+      !setItem(dict, "heights", toArray(m.zs)) ||
+      !setItem(dict, "elangles", toArray(m.elangles)) ||
+      !setItem(dict, "azimuths", toArray(m.azimuths)) ||
+      !setItem(dict, "ranges", toArray(m.ranges)) ||
+      !setItem(dict, "nyquist", toArray(m.vnys)))
+   {
+      Py_DECREF(dict);
+      return nullptr;
+   }
+   return dict;
+}
+
+/**
+   @brief Writes pending output and log records and stops the log sink. Callers hold hoofMutex.
+*/
+static void closeHoof()
+{
+   if(processor)
+      processor->flush();
+   HoofLog::stop();
+}
+
+/**
+   @brief Closes HOOF at interpreter exit.
+*/
+static void exitHoof()
+{
+   std::lock_guard<std::mutex> lock(hoofMutex);
+   closeHoof();
+   processor.reset();
+}
+
+/**
+   @brief hoof.open(namelist, in_folder, out_folder), reads the namelist. Folders need a trailing slash.
+   @param args Arguments of the call.
+   @return None.
+*/
+static PyObject* hoofOpen(PyObject*, PyObject* args)
+{
+   const char* namelist;
+   const char* inFolder;
+   const char* outFolder;
+   if(!PyArg_ParseTuple(args, "sss", &namelist, &inFolder, &outFolder))
+      return nullptr;
+
+   // the lock is taken without the GIL, so a thread processing a file can take the GIL back
+   string error;
+   bool opened = false;
+   Py_BEGIN_ALLOW_THREADS
+   {
+      std::lock_guard<std::mutex> lock(hoofMutex);
+      try
+      {
+         closeHoof();
+         processor.reset();
+         HoofSettings settings(namelist, inFolder, outFolder);
+
+         // same fallbacks as HOOF2, files are processed in the Python process
+         if(HoofSettings::outputMode == "SUPEROBS" && !HoofSettings::superobing)
+            HoofSettings::outputMode = "PLANNED";
+         if(HoofSettings::writeBehind && !HoofIOThread::available())
+            HoofSettings::writeBehind = false;
+         processor = std::make_unique<HoofProcessor>();
+         opened = true;
+      }
+      catch(const std::exception& e)
+      {
+         error = e.what();
+      }
+   }
+   Py_END_ALLOW_THREADS
+   if(!opened)
+   {
+      PyErr_Format(PyExc_RuntimeError, "Could not read namelist %s: %s", namelist, error.c_str());
+      return nullptr;
+   }
+   Py_RETURN_NONE;
+}
+
+/**
+   @brief hoof.process(file_name), processes one file from the input folder and writes its output.
+   @param args Arguments of the call.
+   @return Dict with site, height and the dbz, vrad, dvrad, sdbz and svrad data of the volume, or None if
+      processing failed (see the log file).
+*/
+static PyObject* hoofProcess(PyObject*, PyObject* args)
+{
+   const char* fileName;
+   if(!PyArg_ParseTuple(args, "s", &fileName))
+      return nullptr;
+
+   // other Python threads run while the file is processed, but not other calls of the module
+   string name = fileName;
+   HoofData data;
+   bool opened = true;
+   bool success = false;
+   Py_BEGIN_ALLOW_THREADS
+   {
+      std::lock_guard<std::mutex> lock(hoofMutex);
+      opened = processor != nullptr;
+      try
+      {
+         if(opened)
+            success = processor->process(name, &data);
+      }
+      catch(...)
+      {
+      }
+   }
+   Py_END_ALLOW_THREADS
+   if(!opened)
+   {
+      PyErr_SetString(PyExc_RuntimeError, "hoof.open has to be called first");
+      return nullptr;
+   }
+   if(!success)
+      Py_RETURN_NONE;
+
+   PyObject* volume = PyDict_New();
+   if(volume == nullptr)
+      return nullptr;
+   if(!setItem(volume, "site", PyUnicode_FromString(data.site.c_str())) ||
+      !setItem(volume, "height", PyFloat_FromDouble(data.height)) ||
+      !setItem(volume, "dbz", toDict(data.dbz)) ||
+      !setItem(volume, "vrad", toDict(data.vrad)) ||
+      !setItem(volume, "dvrad", toArray(data.dvrads)) ||
+      !setItem(volume, "sdbz", toDict(data.sdbz)) ||
+      !setItem(volume, "svrad", toDict(data.svrad)))
+   {
+      Py_DECREF(volume);
+      return nullptr;
+   }
+   return volume;
+}
+
+/**
+   @brief hoof.flush(), waits until all output files are written.
+   @return List of files whose output failed.
+*/
+static PyObject* hoofFlush(PyObject*, PyObject*)
+{
+   vector<string> failed;
+   Py_BEGIN_ALLOW_THREADS
+   {
+      std::lock_guard<std::mutex> lock(hoofMutex);
+      if(processor)
+      {
+         failed = processor->flush();
+         HoofLog::flush();
+      }
+   }
+   Py_END_ALLOW_THREADS
+   PyObject* list = PyList_New(0);
+   for(const string& name : failed)
+   {
+      PyObject* item = PyUnicode_FromString(name.c_str());
+      PyList_Append(list, item);
+      Py_DECREF(item);
+   }
+   return list;
+}
+
+static PyMethodDef hoofMethods[] = {
+   {"open", hoofOpen, METH_VARARGS, "open(namelist, in_folder, out_folder): reads the namelist."},
+   {"process", hoofProcess, METH_VARARGS, "process(file_name): processes one file, returns a dict of the volume or None."},
+   {"flush", hoofFlush, METH_NOARGS, "flush(): waits until all output is written, returns the files whose output failed."},
+   {nullptr, nullptr, 0, nullptr}
+};
+
+static PyModuleDef hoofModule = {PyModuleDef_HEAD_INIT, "hoof", "HOOF++ homogenization, dealiasing and superobing.",
+   -1, hoofMethods};
+
+/**
+   @brief Initializes the hoof module.
+   @return The module.
+*/
+PyMODINIT_FUNC PyInit_hoof()
+{
+   arrayType.tp_name = "hoof.Array";
+   arrayType.tp_doc = "Contiguous array of doubles, use numpy.asarray() to view it without copying.";
+   arrayType.tp_basicsize = sizeof(HoofArray);
+   arrayType.tp_flags = Py_TPFLAGS_DEFAULT;
+   arrayType.tp_dealloc = arrayDealloc;
+   arrayType.tp_as_buffer = &arrayBuffer;
+   arrayType.tp_getset = arrayGetSet;
+   if(PyType_Ready(&arrayType) < 0)
+      return nullptr;
+
+   PyObject* module = PyModule_Create(&hoofModule);
+   if(module == nullptr)
+      return nullptr;
+   Py_INCREF(&arrayType);
+   PyModule_AddObject(module, "Array", (PyObject*)&arrayType);
+   Py_AtExit(exitHoof);
+   return module;
+}
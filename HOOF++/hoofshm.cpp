@@ -0,0 +1,85 @@
+/**
+   @file hoofshm.cpp
+   @author Peter Smerkol
+   @brief Reference consumer of the shared memory ring that HOOF2 publishes superobs to (see HoofShm.h).
+
+   Prints one line per published record with the latency from publishing to reading. A converter would
+   use the arrays of the record in place in the same way and check valid() before it trusts them.
+
+   Compiling:
+   g++ -std=c++17 -O2 -o hoofshm -I. HoofShm.cpp hoofshm.cpp -pthread -lrt
+
+   Running:
+   ./hoofshm <ring name> [number of records]
+*/
+
+#include <string>
+#include <iostream>
+#include <cmath>
+#include <ctime>
+#include <HoofAux.h>
+#include <HoofShm.h>
+
+using std::string;
+using std::cout;
+using std::endl;
+
+// ---------------------------------------------------------------------------------
+// -------------------- main function ----------------------------------------------
+// ---------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+   if(argc < 2)
+   {
+      cout << "The syntax is:" << endl;
+      cout << "./hoofshm <ring name> [number of records]" << endl;
+      return -1;
+   }
+   long count = argc > 2 ? HoofAux::to<long>(argv[2]) : -1;
+
+   HoofShm::Reader reader;
+   if(!reader.attach(argv[1]))
+   {
+      cout << "Could not attach to shared memory ring " << argv[1] << endl;
+      return -1;
+   }
+   cout << "Waiting for superobs in " << argv[1] << endl;
+
+   for(long n=0; count < 0 || n < count; )
+   {
+      const HoofShm::Record* record = reader.next(1000);
+      if(record == nullptr)
+         continue;
+      timespec now;
+      clock_gettime(CLOCK_REALTIME, &now);
+      double latency = ((int64_t)now.tv_sec*1000000000 + now.tv_nsec - record->published)/1e6;
+
+      // read the record in place, then check that the producer did not overwrite it meanwhile
+      long size = (long)record->nel*record->naz*record->nr;
+      long good = 0;
+      double sum = 0.0;
+      for(long i=0; i<size; i++)
+      {
+         if(!std::isnan(record->values()[i]))
+         {
+            good++;
+            sum += record->values()[i];
+         }
+      }
+      string file = record->file;
+      string quantity = record->quantity;
+      uint64_t sequence = record->sequence;
+      if(!reader.valid())
+      {
+         cout << "Record " << sequence << " was overwritten while it was read" << endl;
+         continue;
+      }
+      cout << sequence << " " << file << " " << quantity << " " << record->nel << "x" << record->naz << "x" <<
+         record->nr << " values " << good << " mean " << (good > 0 ? sum/good : 0.0) << " latency " << latency <<
+         " ms" << endl;
+      n++;
+   }
+   if(reader.lost() > 0)
+      cout << "Lost records: " << reader.lost() << endl;
+   return 0;
+}
@@ -0,0 +1,140 @@
+/**
+   @file hoofshmbench.cpp
+   @author Peter Smerkol
+   @brief Latency benchmark of the shared memory ring (see HoofShm.h).
+
+   Publishes synthetic superobs of a given size with a pause between records to a forked consumer, which
+   measures the latency from publishing to reading with the futex wake up, then publishes them back to back
+   to measure the throughput.
+
+   Compiling:
+   g++ -std=c++17 -O2 -o hoofshmbench -I. HoofShm.cpp hoofshmbench.cpp -pthread -lrt
+
+   Running:
+   ./hoofshmbench [number of records] [nel] [naz] [nr]
+*/
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <ctime>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <HoofTypes.h>
+#include <HoofAux.h>
+#include <HoofData.h>
+#include <HoofShm.h>
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::endl;
+using namespace hoof;
+
+/**
+   @brief Reads records in the consumer process and prints the latency percentiles.
+   @param name Name of the ring.
+   @param count Number of records to read.
+   @param ready Pipe that tells the producer the consumer is attached.
+   @return Exit code of the consumer.
+*/
+static int consume(const string& name, int count, int ready)
+{
+   HoofShm::Reader reader;
+   bool attached = reader.attach(name);
+   char c = attached ? '1' : '0';
+   if(write(ready, &c, 1) != 1 || !attached)
+      return 1;
+
+   // latency of records published one by one
+   vector<double> latencies;
+   for(int i=0; i<count; i++)
+   {
+      const HoofShm::Record* record = reader.next(5000);
+      if(record == nullptr)
+         return 1;
+      timespec now;
+      clock_gettime(CLOCK_REALTIME, &now);
+      latencies.push_back(((int64_t)now.tv_sec*1000000000 + now.tv_nsec - record->published)/1e3);
+   }
+   std::sort(latencies.begin(), latencies.end());
+   cout << "Latency:    p50 " << latencies[count/2] << " us, p99 " << latencies[count*99/100] << " us, max " <<
+      latencies.back() << " us" << endl;
+
+   // throughput of records published back to back, each record is read in place
+   Clock clock;
+   Time start = clock.now();
+   uint64_t bytes = 0;
+   int valid = 0;
+   for(int i=0; i<count; i++)
+   {
+      const HoofShm::Record* record = reader.next(5000);
+      if(record == nullptr)
+         break;
+      double sum = 0.0;
+      for(long j=0; j<(long)record->nel*record->naz*record->nr; j++)
+         sum += record->values()[j];
+      valid += reader.valid() && sum > 0.0;
+      bytes += record->size;
+   }
+   double seconds = std::chrono::duration<double>(clock.now() - start).count();
+   cout << "Throughput: " << valid << " records, " << bytes/seconds/1e6 << " MB/s, lost " << reader.lost() << endl;
+   return 0;
+}
+
+// ---------------------------------------------------------------------------------
+// -------------------- main function ----------------------------------------------
+// ---------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+   int count = argc > 1 ? HoofAux::to<int>(argv[1]) : 1000;
+   int nel = argc > 2 ? HoofAux::to<int>(argv[2]) : 10;
+   int naz = argc > 3 ? HoofAux::to<int>(argv[3]) : 360;
+   int nr = argc > 4 ? HoofAux::to<int>(argv[4]) : 100;
+   string name = "/hoofshmbench." + std::to_string(getpid());
+   if(!HoofShm::start(name, 64.0))
+      return 1;
+
+   // superobs of one synthetic volume
+   HoofData data;
+   data.site = "bench";
+   data.sdbz.elangles = vector<double>(nel, 0.01);
+   data.sdbz.azimuths = vector2D<double>(nel, vector<double>(naz, 1.0));
+   data.sdbz.ranges = vector2D<double>(nel, vector<double>(nr, 1000.0));
+   data.sdbz.meas = vector3D<double>(nel, vector2D<double>(naz, vector<double>(nr, 10.0)));
+   data.sdbz.quals = data.sdbz.meas;
+   cout << "Record size: " << (sizeof(HoofShm::Record) + 8*(nel + nel*naz + nel*nr + 2*nel*naz*nr))/1024 << " kB" << endl;
+
+   int ready[2];
+   if(pipe(ready) != 0)
+      return 1;
+   pid_t pid = fork();
+   if(pid == 0)
+      _exit(consume(name, count, ready[1]));
+   char c;
+   if(read(ready[0], &c, 1) != 1 || c != '1')
+   {
+      cout << "Consumer could not attach" << endl;
+      shm_unlink(name.c_str());
+      return 1;
+   }
+
+   // one by one, so the consumer waits on the futex for every record
+   for(int i=0; i<count; i++)
+   {
+      HoofShm::publish("bench.h5", data);
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+   }
+   // back to back
+   for(int i=0; i<count; i++)
+      HoofShm::publish("bench.h5", data);
+
+   int status;
+   waitpid(pid, &status, 0);
+   shm_unlink(name.c_str());
+   return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
@@ -0,0 +1,181 @@
+/**
+   @file hoofsuperobbench.cpp
+   @author Peter Smerkol
+   @brief Benchmark of the superob kernels compiled for fixed range bin and ray angle factors.
+
+   Superobs a synthetic volume of DBZ and VRAD data for the factor combinations that have compiled
+   kernels, and one that uses the generic kernels, once with [Specialized superob kernels] FALSE and once
+   with TRUE, in both precisions. Prints the fastest superobing time of both, the gain, and whether the
+   superobs are the same.
+
+   Compiling:
+   h5c++ -std=c++17 -O2 -o hoofsuperobbench -I. Hoof*.cpp hoofsuperobbench.cpp -lgsl -lgslcblas -lz -pthread
+
+   Running:
+   ./hoofsuperobbench [repeats] [nel] [naz] [nr]
+*/
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <HoofTypes.h>
+#include <HoofAux.h>
+#include <HoofSettings.h>
+#include <HoofH5File.h>
+#include <HoofData.h>
+#include <HoofSuperober.h>
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::endl;
+using std::setw;
+using namespace hoof;
+
+/**
+   @brief Fills a measurement with random values, a share of them NaN.
+   @param m The measurement.
+   @param nel Number of elevations.
+   @param naz Number of azimuths.
+   @param nr Number of range bins.
+   @param min Smallest value.
+   @param max Largest value.
+   @param nans Share of NaN values.
+   @param gen The random number generator.
+*/
+static void fill(HoofMeasurement& m, int nel, int naz, int nr, double min, double max, double nans, std::mt19937& gen)
+{
+   std::uniform_real_distribution<double> value(min, max);
+   std::uniform_real_distribution<double> unit(0.0, 1.0);
+   m.nel = nel;
+   m.nazMax = naz;
+   m.nrMax = nr;
+   m.naz = vector<int>(nel, naz);
+   m.nr = vector<int>(nel, nr);
+   m.elangles = vector<double>(nel, 0.0);
+   m.rscales = vector<double>(nel, 250.0);
+   m.rstarts = vector<double>(nel, 0.0);
+   m.meas = vector3D<double>(nel, vector2D<double>(naz, vector<double>(nr, dNaN)));
+   m.ths = vector3D<double>(nel, vector2D<double>(naz, vector<double>(nr, dNaN)));
+   m.quals = vector3D<double>(nel, vector2D<double>(naz, vector<double>(nr, 0.0)));
+   for(int i=0; i<nel; i++)
+   {
+      m.elangles[i] = HoofAux::Pi*(0.5 + i)/180.0;
+      for(int j=0; j<naz; j++)
+      {
+         for(int k=0; k<nr; k++)
+         {
+            if(unit(gen) >= nans)
+            {
+               m.meas[i][j][k] = value(gen);
+               m.ths[i][j][k] = m.meas[i][j][k] + unit(gen);
+            }
+            m.quals[i][j][k] = unit(gen);
+         }
+      }
+   }
+}
+
+/**
+   @brief Checks if two superobed arrays are the same, NaN where the other is NaN.
+   @param a First array.
+   @param b Second array.
+   @return True if they are the same.
+*/
+static bool same(const vector3D<double>& a, const vector3D<double>& b)
+{
+   if(a.size() != b.size())
+      return false;
+   for(int i=0; i<a.size(); i++)
+   {
+      for(int j=0; j<a[i].size(); j++)
+      {
+         for(int k=0; k<a[i][j].size(); k++)
+         {
+            if(!(a[i][j][k] == b[i][j][k] || (std::isnan(a[i][j][k]) && std::isnan(b[i][j][k]))))
+               return false;
+         }
+      }
+   }
+   return true;
+}
+
+/**
+   @brief Superobs the data with the generic and the specialized kernels and prints the fastest times.
+   @param data The data, receives the superobs.
+   @param precision Name of the precision.
+   @param repeats Number of superobings of each kind.
+*/
+template<typename T>
+static void bench(HoofData& data, const string& precision, int repeats)
+{
+   HoofH5File none;
+   HoofSuperober<T> superober(data, none);
+   superober.prepareMetadata();
+   double best[2] = {1e30, 1e30};
+   vector3D<double> sdbz[2];
+   vector3D<double> svrad[2];
+
+   // the kernels take turns, so both see the same state of the machine
+   for(int r=0; r<repeats; r++)
+   {
+      for(int specialized=0; specialized<2; specialized++)
+      {
+         HoofSettings::specializedSuperob = specialized == 1;
+         Clock clock;
+         Time start = clock.now();
+         superober.superob();
+         best[specialized] = std::min(best[specialized], std::chrono::duration<double>(clock.now() - start).count());
+         sdbz[specialized] = data.sdbz.meas;
+         svrad[specialized] = data.svrad.meas;
+      }
+   }
+   cout << setw(4) << HoofSettings::rangeBinFactor << "x" << HoofSettings::rayAngleFactor << setw(10) << precision <<
+      setw(12) << 1e3*best[0] << " ms" << setw(12) << 1e3*best[1] << " ms" << setw(9) << best[0]/best[1] << "x" <<
+      ((same(sdbz[0], sdbz[1]) && same(svrad[0], svrad[1])) ? "   same" : "   DIFFERENT") << endl;
+}
+
+// ---------------------------------------------------------------------------------
+// -------------------- main function ----------------------------------------------
+// ---------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+   int repeats = argc > 1 ? HoofAux::to<int>(argv[1]) : 5;
+   int nel = argc > 2 ? HoofAux::to<int>(argv[2]) : 10;
+   int naz = argc > 3 ? HoofAux::to<int>(argv[3]) : 360;
+   int nr = argc > 4 ? HoofAux::to<int>(argv[4]) : 1000;
+
+   // superobing settings of the namelist
+   HoofSettings::superobing = true;
+   HoofSettings::dealiasing = false;
+   HoofSettings::maxArcSize = 10000.0;
+   HoofSettings::minQuality = 0.7;
+   HoofSettings::dbzClearsky = 12.0;
+   HoofSettings::dbzPercentage = 0.3;
+   HoofSettings::vradPercentage = 0.3;
+   HoofSettings::vradMaxStd = 10.0;
+
+   // synthetic volume
+   std::mt19937 gen(1);
+   HoofData data;
+   fill(data.dbz, nel, naz, nr, -10.0, 60.0, 0.3, gen);
+   fill(data.vrad, nel, naz, nr, -30.0, 30.0, 0.4, gen);
+
+   // compiled combinations and one generic
+   cout << "Superobing " << nel << " x " << naz << " x " << nr << " bins of DBZ and VRAD, fastest of " << repeats << endl;
+   cout << "factors precision     generic     specialized     gain" << endl;
+   vector<std::pair<int, int>> factors = {{5, 1}, {3, 3}, {10, 1}, {2, 2}};
+   for(auto& f : factors)
+   {
+      HoofSettings::rangeBinFactor = f.first;
+      HoofSettings::rayAngleFactor = f.second;
+      bench<double>(data, "FLOAT64", repeats);
+      bench<float>(data, "FLOAT32", repeats);
+   }
+   return 0;
+}